@@ -0,0 +1,375 @@
+// Benchmarks of the SearchServer hot paths, built on Google Benchmark.
+//
+// Build it from the sources of the server, e.g.
+//   g++ -std=c++17 -O2 -I.. search_server_benchmark.cpp ../corpus_ingestion.cpp ../counting_resource.cpp ../document.cpp ../document_filter.cpp ../generators.cpp ../metrics.cpp ../positions.cpp
+//       ../process_queries.cpp ../query_arena.cpp ../search_server.cpp ../stop_words.cpp ../string_processing.cpp
+//       -lbenchmark -ltbb -lpthread -o search_server_benchmark
+//
+// Every benchmark runs over reproducible corpora (fixed seed) parameterized by
+// docs  - number of documents,
+// vocab - dictionary size,
+// zipf  - exponent of the word distribution multiplied by 100 (0 - uniform).
+// Besides time and throughput it reports latency percentiles of a single operation (p50/p90/p99/max, ns)
+// and heap allocations per operation.
+//
+// JSON output:        ./search_server_benchmark --benchmark_format=json --benchmark_out=run.json
+// Compare two runs:   compare.py benchmarks base.json run.json   (tools/ of Google Benchmark)
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <execution>
+#include <map>
+#include <memory>
+#include <new>
+#include <random>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "corpus_ingestion.h"
+#include "generators.h"
+#include "process_queries.h"
+#include "search_server.h"
+#include "string_processing.h"
+
+namespace {
+
+std::atomic<long long> allocation_count{ 0 };
+std::atomic<long long> allocated_bytes{ 0 };
+
+}  // namespace
+
+// The replacements pair new with malloc and delete with free on purpose,
+// GCC sees free called on memory from new once they get inlined
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(std::size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes.fetch_add(static_cast<long long>(size), std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+// std::pmr::new_delete_resource allocates through the aligned form
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes.fetch_add(static_cast<long long>(size), std::memory_order_relaxed);
+    const std::size_t align = std::max(static_cast<std::size_t>(alignment), sizeof(void*));
+    void* ptr = nullptr;
+    if (posix_memalign(&ptr, align, size == 0 ? 1 : size) == 0) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+namespace {
+
+const int DOCUMENT_WORD_COUNT = 70;
+const int MAX_WORD_LENGTH = 10;
+const int QUERY_COUNT = 100;
+const int QUERY_WORD_COUNT = 10;
+const double MINUS_WORD_PROB = 0.1;
+const unsigned SEED = 42;
+
+struct Corpus {
+    std::vector<std::string> dictionary;
+    std::vector<std::string> documents;
+    std::vector<std::string> queries;
+    std::vector<std::string> phrase_queries; // a phrase of a document and one more word of it
+};
+
+using CorpusKey = std::tuple<int, int, int>;
+
+CorpusKey GetCorpusKey(const benchmark::State& state) {
+    return { static_cast<int>(state.range(0)), static_cast<int>(state.range(1)), static_cast<int>(state.range(2)) };
+}
+
+const Corpus& GetCorpus(const benchmark::State& state) {
+    static std::map<CorpusKey, Corpus> corpora;
+    const CorpusKey key = GetCorpusKey(state);
+    auto it = corpora.find(key);
+    if (it == corpora.end()) {
+        const auto [document_count, vocabulary_size, zipf_percent] = key;
+        std::mt19937 generator(SEED);
+        Corpus corpus;
+        corpus.dictionary = GenerateDictionary(generator, vocabulary_size, MAX_WORD_LENGTH);
+        const ZipfDistribution distribution(static_cast<int>(corpus.dictionary.size()), zipf_percent / 100.0);
+        corpus.documents = GenerateZipfQueries(generator, corpus.dictionary, distribution, document_count, DOCUMENT_WORD_COUNT);
+        corpus.queries = GenerateZipfQueries(generator, corpus.dictionary, distribution, QUERY_COUNT, QUERY_WORD_COUNT, MINUS_WORD_PROB);
+        for (int i = 0; i < QUERY_COUNT; ++i) {
+            const auto words = SplitIntoWords(std::string_view(corpus.documents[i % corpus.documents.size()]));
+            corpus.phrase_queries.push_back("\"" + std::string(words[1]) + " " + std::string(words[2]) + "\"~2 " + std::string(words[3]));
+        }
+        it = corpora.emplace(key, std::move(corpus)).first;
+    }
+    return it->second;
+}
+
+std::unique_ptr<SearchServer> BuildServer(const Corpus& corpus, IndexOptions options = {}) {
+    auto search_server = std::make_unique<SearchServer>(corpus.dictionary[0], options);
+    for (std::size_t i = 0; i < corpus.documents.size(); ++i) {
+        search_server->AddDocument(static_cast<int>(i), corpus.documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+    }
+    return search_server;
+}
+
+// Servers are read-only for query benchmarks, so they are built once per corpus
+const SearchServer& GetServer(const benchmark::State& state, IndexOptions options = {}) {
+    static std::map<std::pair<CorpusKey, bool>, std::unique_ptr<SearchServer>> servers;
+    auto& search_server = servers[{ GetCorpusKey(state), options.store_positions }];
+    if (!search_server) {
+        search_server = BuildServer(GetCorpus(state), options);
+    }
+    return *search_server;
+}
+
+// Measures single operations inside the benchmark loop and reports
+// their latency percentiles and allocations per operation as counters
+class OperationStats {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    void Start() {
+        allocations_before_ = allocation_count.load(std::memory_order_relaxed);
+        bytes_before_ = allocated_bytes.load(std::memory_order_relaxed);
+        start_time_ = Clock::now();
+    }
+
+    void Stop() {
+        const auto duration = Clock::now() - start_time_;
+        latencies_.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+        allocations_ += allocation_count.load(std::memory_order_relaxed) - allocations_before_;
+        bytes_ += allocated_bytes.load(std::memory_order_relaxed) - bytes_before_;
+    }
+
+    void Report(benchmark::State& state) {
+        if (latencies_.empty()) {
+            return;
+        }
+        std::sort(latencies_.begin(), latencies_.end());
+        const auto percentile = [this](double p) {
+            return static_cast<double>(latencies_[static_cast<std::size_t>(p * (latencies_.size() - 1))]);
+        };
+        state.counters["p50_ns"] = percentile(0.5);
+        state.counters["p90_ns"] = percentile(0.9);
+        state.counters["p99_ns"] = percentile(0.99);
+        state.counters["max_ns"] = static_cast<double>(latencies_.back());
+        state.counters["allocs_per_op"] = static_cast<double>(allocations_) / latencies_.size();
+        state.counters["alloc_bytes_per_op"] = static_cast<double>(bytes_) / latencies_.size();
+    }
+
+private:
+    std::vector<long long> latencies_;
+    long long allocations_ = 0;
+    long long bytes_ = 0;
+    long long allocations_before_ = 0;
+    long long bytes_before_ = 0;
+    Clock::time_point start_time_;
+};
+
+void CorpusArguments(benchmark::internal::Benchmark* benchmark) {
+    benchmark->ArgNames({ "docs", "vocab", "zipf" })
+        ->ArgsProduct({ { 1'000, 10'000 }, { 1'000, 20'000 }, { 0, 100 } })
+        ->Unit(benchmark::kMicrosecond);
+}
+
+void BM_AddDocument(benchmark::State& state) {
+    const Corpus& corpus = GetCorpus(state);
+    OperationStats stats;
+    auto search_server = std::make_unique<SearchServer>(corpus.dictionary[0]);
+    std::size_t i = 0;
+    for (auto _ : state) {
+        if (i == corpus.documents.size()) {
+            state.PauseTiming();
+            search_server = std::make_unique<SearchServer>(corpus.dictionary[0]);
+            i = 0;
+            state.ResumeTiming();
+        }
+        stats.Start();
+        search_server->AddDocument(static_cast<int>(i), corpus.documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+        stats.Stop();
+        ++i;
+    }
+    state.SetItemsProcessed(state.iterations());
+    stats.Report(state);
+}
+BENCHMARK(BM_AddDocument)->Apply(CorpusArguments);
+
+// Loads the whole corpus in the ingestion format through the reader/tokenizer/indexer pipeline
+void BM_IngestCorpus(benchmark::State& state) {
+    const Corpus& corpus = GetCorpus(state);
+    std::string tsv;
+    for (std::size_t i = 0; i < corpus.documents.size(); ++i) {
+        tsv += std::to_string(i) + "\tACTUAL\t1 2 3\t" + corpus.documents[i] + "\n";
+    }
+    for (auto _ : state) {
+        SearchServer search_server(corpus.dictionary[0]);
+        const IngestStats stats = IngestCorpus(search_server, tsv);
+        benchmark::DoNotOptimize(stats);
+    }
+    state.SetItemsProcessed(state.iterations() * corpus.documents.size());
+    state.SetBytesProcessed(state.iterations() * tsv.size());
+}
+BENCHMARK(BM_IngestCorpus)->Apply(CorpusArguments);
+
+template <typename ExecutionPolicy>
+void BM_FindTopDocuments(benchmark::State& state, ExecutionPolicy policy) {
+    const Corpus& corpus = GetCorpus(state);
+    const SearchServer& search_server = GetServer(state);
+    OperationStats stats;
+    std::size_t i = 0;
+    for (auto _ : state) {
+        stats.Start();
+        auto documents = search_server.FindTopDocuments(policy, corpus.queries[i]);
+        stats.Stop();
+        benchmark::DoNotOptimize(documents);
+        i = (i + 1) % corpus.queries.size();
+    }
+    state.SetItemsProcessed(state.iterations());
+    stats.Report(state);
+}
+BENCHMARK_CAPTURE(BM_FindTopDocuments, seq, std::execution::seq)->Apply(CorpusArguments);
+BENCHMARK_CAPTURE(BM_FindTopDocuments, par, std::execution::par)->Apply(CorpusArguments);
+
+enum class SteadyStateQueries {
+    PLAIN,
+    PHRASE, // decodes positions of the candidates
+    FILTER, // evaluates a DocumentFilter on the secondary indexes first
+};
+
+// Heap allocations of the query path once the thread arena has grown to fit the queries.
+// The returned vector is the only allocation a query is allowed to make,
+// so query_path_allocs_per_op must stay 0.
+template <typename ExecutionPolicy>
+void BM_FindTopDocumentsSteadyState(benchmark::State& state, ExecutionPolicy policy, SteadyStateQueries kind) {
+    const Corpus& corpus = GetCorpus(state);
+    const SearchServer& search_server = GetServer(state, IndexOptions{ kind == SteadyStateQueries::PHRASE });
+    const std::vector<std::string>& queries = kind == SteadyStateQueries::PHRASE ? corpus.phrase_queries : corpus.queries;
+    // The selective filter drives the posting scan, the wide one is only checked per document
+    const std::vector<DocumentFilter> filters = {
+        DocumentFilter::IdRange(0, static_cast<int>(corpus.documents.size() / 20)),
+        DocumentFilter::And({ DocumentFilter::WithStatus({ DocumentStatus::ACTUAL }), DocumentFilter::RatingRange(0, 10) }),
+    };
+    const auto find_top_documents = [&](std::size_t i) {
+        if (kind == SteadyStateQueries::FILTER) {
+            return search_server.FindTopDocuments(policy, queries[i], filters[i % filters.size()]);
+        }
+        return search_server.FindTopDocuments(policy, queries[i]);
+    };
+
+    for (std::size_t i = 0; i < queries.size(); ++i) {
+        benchmark::DoNotOptimize(find_top_documents(i));
+    }
+    long long query_path_allocations = 0;
+    std::size_t i = 0;
+    for (auto _ : state) {
+        const long long allocations_before = allocation_count.load(std::memory_order_relaxed);
+        auto documents = find_top_documents(i);
+        const long long allocations = allocation_count.load(std::memory_order_relaxed) - allocations_before;
+        query_path_allocations += allocations - (documents.empty() ? 0 : 1);
+        benchmark::DoNotOptimize(documents);
+        i = (i + 1) % queries.size();
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["query_path_allocs_per_op"] = static_cast<double>(query_path_allocations) / state.iterations();
+    if (query_path_allocations > 0) {
+        state.SkipWithError("the query path allocates from the global heap");
+    }
+}
+BENCHMARK_CAPTURE(BM_FindTopDocumentsSteadyState, seq, std::execution::seq, SteadyStateQueries::PLAIN)->Apply(CorpusArguments);
+BENCHMARK_CAPTURE(BM_FindTopDocumentsSteadyState, par, std::execution::par, SteadyStateQueries::PLAIN)->Apply(CorpusArguments);
+BENCHMARK_CAPTURE(BM_FindTopDocumentsSteadyState, phrase, std::execution::seq, SteadyStateQueries::PHRASE)->Apply(CorpusArguments);
+BENCHMARK_CAPTURE(BM_FindTopDocumentsSteadyState, filter, std::execution::seq, SteadyStateQueries::FILTER)->Apply(CorpusArguments);
+
+template <typename ExecutionPolicy>
+void BM_MatchDocument(benchmark::State& state, ExecutionPolicy policy) {
+    const Corpus& corpus = GetCorpus(state);
+    const SearchServer& search_server = GetServer(state);
+    OperationStats stats;
+    std::size_t i = 0;
+    for (auto _ : state) {
+        const int document_id = static_cast<int>(i % corpus.documents.size());
+        stats.Start();
+        auto result = search_server.MatchDocument(policy, corpus.queries[i % corpus.queries.size()], document_id);
+        stats.Stop();
+        benchmark::DoNotOptimize(result);
+        ++i;
+    }
+    state.SetItemsProcessed(state.iterations());
+    stats.Report(state);
+}
+BENCHMARK_CAPTURE(BM_MatchDocument, seq, std::execution::seq)->Apply(CorpusArguments);
+BENCHMARK_CAPTURE(BM_MatchDocument, par, std::execution::par)->Apply(CorpusArguments);
+
+void BM_RemoveDocument(benchmark::State& state) {
+    const Corpus& corpus = GetCorpus(state);
+    OperationStats stats;
+    auto search_server = BuildServer(corpus);
+    std::size_t i = 0;
+    for (auto _ : state) {
+        if (i == corpus.documents.size()) {
+            state.PauseTiming();
+            search_server = BuildServer(corpus);
+            i = 0;
+            state.ResumeTiming();
+        }
+        stats.Start();
+        search_server->RemoveDocument(static_cast<int>(i));
+        stats.Stop();
+        ++i;
+    }
+    state.SetItemsProcessed(state.iterations());
+    stats.Report(state);
+}
+BENCHMARK(BM_RemoveDocument)->Apply(CorpusArguments);
+
+void BM_ProcessQueries(benchmark::State& state) {
+    const Corpus& corpus = GetCorpus(state);
+    const SearchServer& search_server = GetServer(state);
+    OperationStats stats;
+    for (auto _ : state) {
+        stats.Start();
+        auto results = ProcessQueries(search_server, corpus.queries);
+        stats.Stop();
+        benchmark::DoNotOptimize(results);
+    }
+    // One operation is a whole batch, items are queries
+    state.SetItemsProcessed(state.iterations() * corpus.queries.size());
+    stats.Report(state);
+}
+BENCHMARK(BM_ProcessQueries)->Apply(CorpusArguments);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+// Queue between the stages of a pipeline. Push blocks while the queue is full,
+// so a fast producer waits for the consumer instead of buffering without limit.
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(std::size_t capacity)
+        : capacity_(capacity == 0 ? 1 : capacity)
+    {
+    }
+
+    // Blocks while the queue is full. Returns false if the queue is cancelled, the value is dropped then
+    bool Push(T value) {
+        std::unique_lock lock(mutex_);
+        not_full_.wait(lock, [this] { return values_.size() < capacity_ || is_cancelled_; });
+        if (is_cancelled_) {
+            return false;
+        }
+        values_.push_back(std::move(value));
+        not_empty_.notify_one();
+        return true;
+    }
+
+    // Blocks while the queue is empty. Returns nothing once the queue is closed and drained, or cancelled
+    std::optional<T> Pop() {
+        std::unique_lock lock(mutex_);
+        not_empty_.wait(lock, [this] { return !values_.empty() || is_closed_ || is_cancelled_; });
+        if (is_cancelled_ || values_.empty()) {
+            return std::nullopt;
+        }
+        T value = std::move(values_.front());
+        values_.pop_front();
+        not_full_.notify_one();
+        return value;
+    }
+
+    // No more values will be pushed, the consumers get the rest
+    void Close() {
+        std::lock_guard guard(mutex_);
+        is_closed_ = true;
+        not_empty_.notify_all();
+    }
+
+    // Stops the pipeline: the queued values are dropped and all the waiting threads are woken up
+    void Cancel() {
+        std::lock_guard guard(mutex_);
+        is_cancelled_ = true;
+        values_.clear();
+        not_empty_.notify_all();
+        not_full_.notify_all();
+    }
+
+private:
+    const std::size_t capacity_;
+    std::deque<T> values_;
+    bool is_closed_ = false;
+    bool is_cancelled_ = false;
+    std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+};
+
+// Limits the items in flight through several stages: the first stage acquires a slot per item,
+// the last one releases it. Unlike the queues between the stages, it also bounds the items
+// a stage holds on its own, e.g. waiting to be put back in order.
+class CountingSemaphore {
+public:
+    explicit CountingSemaphore(std::size_t count)
+        : count_(count == 0 ? 1 : count)
+    {
+    }
+
+    // Blocks while no slot is free. Returns false if the semaphore is cancelled
+    bool Acquire() {
+        std::unique_lock lock(mutex_);
+        released_.wait(lock, [this] { return count_ > 0 || is_cancelled_; });
+        if (is_cancelled_) {
+            return false;
+        }
+        --count_;
+        return true;
+    }
+
+    void Release() {
+        std::lock_guard guard(mutex_);
+        ++count_;
+        released_.notify_one();
+    }
+
+    // Wakes up all the waiting threads, Acquire fails from now on
+    void Cancel() {
+        std::lock_guard guard(mutex_);
+        is_cancelled_ = true;
+        released_.notify_all();
+    }
+
+private:
+    std::size_t count_;
+    bool is_cancelled_ = false;
+    std::mutex mutex_;
+    std::condition_variable released_;
+};
@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 #include <map>
+#include <memory_resource>
 #include <mutex>
 #include <string>
 #include <vector>
@@ -18,8 +19,10 @@ public:
         Value& ref_to_value;
     };
 
-    explicit ConcurrentMap(std::size_t bucket_count)
-        : vector_maps_(bucket_count)
+    // Every bucket allocates its nodes from its own monotonic resource under the bucket mutex,
+    // so erased nodes are not reused. resource must be safe to use from several threads.
+    explicit ConcurrentMap(std::size_t bucket_count, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : vector_maps_(bucket_count, resource)
     {
     }
 
@@ -31,13 +34,31 @@ public:
 
     void erase(const Key& key) {
         const std::size_t num_of_bukets = static_cast<uint64_t>(key) % vector_maps_.size();
-        std::lock_guard(vector_maps_[num_of_bukets].mutex);
+        std::lock_guard guard(vector_maps_[num_of_bukets].mutex);
         vector_maps_[num_of_bukets].map.erase(key);
     }
 
+    std::size_t size() {
+        std::size_t result = 0;
+        for (auto& [bucket_resource, map, mutex] : vector_maps_) {
+            std::lock_guard guard(mutex);
+            result += map.size();
+        }
+        return result;
+    }
+
     std::map<Key, Value> BuildOrdinaryMap() {
         std::map<Key, Value> result;
-        for (auto& [map, mutex] : vector_maps_) {
+        for (auto& [bucket_resource, map, mutex] : vector_maps_) {
+            std::lock_guard guard(mutex);
+            result.insert(map.begin(), map.end());
+        }
+        return result;
+    }
+
+    std::pmr::map<Key, Value> BuildOrdinaryMap(std::pmr::memory_resource* resource) {
+        std::pmr::map<Key, Value> result(resource);
+        for (auto& [bucket_resource, map, mutex] : vector_maps_) {
             std::lock_guard guard(mutex);
             result.insert(map.begin(), map.end());
         }
@@ -46,9 +67,18 @@ public:
 
 private:
     struct Buket {
-        std::map<Key, Value> map;
+        using allocator_type = std::pmr::polymorphic_allocator<Buket>;
+
+        explicit Buket(const allocator_type& allocator)
+            : resource(allocator.resource())
+            , map(&resource)
+        {
+        }
+
+        std::pmr::monotonic_buffer_resource resource;
+        std::pmr::map<Key, Value> map;
         std::mutex mutex;
     };
 
-    std::vector<Buket> vector_maps_;
+    std::pmr::vector<Buket> vector_maps_;
 };
\ No newline at end of file
@@ -0,0 +1,303 @@
+#include "corpus_ingestion.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "bounded_queue.h"
+
+using namespace std::string_literals;
+
+namespace {
+
+const std::size_t PAGE_SIZE = 4096;
+
+struct Chunk {
+    std::string_view text;
+    std::size_t offset = 0; // of the text in the corpus
+};
+
+struct ParsedDocument {
+    int id = 0;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+    SearchServer::TokenizedDocument words;
+    std::size_t offset = 0; // of the line in the corpus
+};
+
+// Documents of one chunk. A malformed line ends the batch with its error,
+// which the indexer throws once it has indexed the documents before the line
+struct DocumentBatch {
+    std::size_t offset = 0; // of the chunk in the corpus
+    std::size_t end = 0;    // offset of the next chunk
+    std::vector<ParsedDocument> documents;
+    std::exception_ptr error;
+};
+
+[[noreturn]] void ThrowAtOffset(std::size_t offset, const std::string& reason) {
+    throw std::invalid_argument("Corpus line at byte "s + std::to_string(offset) + ": "s + reason);
+}
+
+// Cuts the text up to the next tab off the line
+std::string_view TakeField(std::string_view& line) {
+    const std::size_t tab_pos = line.find('\t');
+    if (tab_pos == std::string_view::npos) {
+        throw std::invalid_argument("Expected 4 tab separated fields"s);
+    }
+    const std::string_view field = line.substr(0, tab_pos);
+    line.remove_prefix(tab_pos + 1);
+    return field;
+}
+
+int ParseInt(std::string_view text) {
+    int value = 0;
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (error != std::errc() || end != text.data() + text.size() || text.empty()) {
+        throw std::invalid_argument("Number ["s + std::string(text) + "] is invalid"s);
+    }
+    return value;
+}
+
+DocumentStatus ParseStatus(std::string_view text) {
+    static const std::pair<std::string_view, DocumentStatus> names[] = {
+        { "ACTUAL", DocumentStatus::ACTUAL },
+        { "IRRELEVANT", DocumentStatus::IRRELEVANT },
+        { "BANNED", DocumentStatus::BANNED },
+        { "REMOVED", DocumentStatus::REMOVED },
+    };
+    for (const auto& [name, status] : names) {
+        if (name == text) {
+            return status;
+        }
+    }
+    throw std::invalid_argument("Document status ["s + std::string(text) + "] is invalid"s);
+}
+
+ParsedDocument ParseLine(const SearchServer& search_server, std::string_view line, std::size_t offset) {
+    ParsedDocument document;
+    document.offset = offset;
+    try {
+        document.id = ParseInt(TakeField(line));
+        document.status = ParseStatus(TakeField(line));
+        std::string_view ratings = TakeField(line);
+        while (!ratings.empty()) {
+            const std::size_t space_pos = std::min(ratings.find(' '), ratings.size());
+            if (space_pos > 0) {
+                document.ratings.push_back(ParseInt(ratings.substr(0, space_pos)));
+            }
+            ratings.remove_prefix(std::min(space_pos + 1, ratings.size()));
+        }
+        document.words = search_server.TokenizeDocument(line);
+    }
+    catch (const std::invalid_argument& e) {
+        ThrowAtOffset(offset, e.what());
+    }
+    return document;
+}
+
+DocumentBatch ParseChunk(const SearchServer& search_server, const Chunk& chunk) {
+    DocumentBatch batch;
+    batch.offset = chunk.offset;
+    batch.end = chunk.offset + chunk.text.size();
+    std::string_view text = chunk.text;
+    while (!text.empty()) {
+        const std::size_t line_end = std::min(text.find('\n'), text.size());
+        std::string_view line = text.substr(0, line_end);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (!line.empty()) {
+            try {
+                batch.documents.push_back(ParseLine(search_server, line, chunk.offset + (text.data() - chunk.text.data())));
+            }
+            catch (const std::invalid_argument&) {
+                batch.error = std::current_exception();
+                break;
+            }
+        }
+        text.remove_prefix(std::min(line_end + 1, text.size()));
+    }
+    return batch;
+}
+
+// Reads a byte of every page, so that the tokenizers don't wait for the disk
+void FaultPagesIn(std::string_view text) {
+    volatile char sink = 0;
+    for (std::size_t i = 0; i < text.size(); i += PAGE_SIZE) {
+        sink = text[i];
+    }
+    (void)sink;
+}
+
+}  // namespace
+
+MappedFile::MappedFile(const std::string& path) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "Can't open corpus file ["s + path + "]"s);
+    }
+    struct stat file_stat {};
+    if (fstat(fd, &file_stat) < 0) {
+        const int error = errno;
+        close(fd);
+        throw std::system_error(error, std::generic_category(), "Can't stat corpus file ["s + path + "]"s);
+    }
+    size_ = static_cast<std::size_t>(file_stat.st_size);
+    if (size_ > 0) {
+        void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            const int error = errno;
+            close(fd);
+            throw std::system_error(error, std::generic_category(), "Can't map corpus file ["s + path + "]"s);
+        }
+        madvise(data, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<const char*>(data);
+    }
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (data_) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+}
+
+std::string_view MappedFile::GetData() const {
+    return { data_, size_ };
+}
+
+IngestStats IngestCorpusFile(SearchServer& search_server, const std::string& path, const IngestOptions& options) {
+    const MappedFile file(path);
+    return IngestCorpus(search_server, file.GetData(), options);
+}
+
+IngestStats IngestCorpus(SearchServer& search_server, std::string_view corpus, const IngestOptions& options) {
+    std::size_t tokenizer_count = options.tokenizer_count;
+    if (tokenizer_count == 0) {
+        tokenizer_count = std::max<std::size_t>(std::thread::hardware_concurrency(), 3) - 2;
+    }
+    const std::size_t chunk_size = std::max<std::size_t>(options.chunk_size, 1);
+
+    BoundedQueue<Chunk> chunks(options.queue_capacity);
+    BoundedQueue<DocumentBatch> batches(options.queue_capacity);
+    // Batches may finish out of order and wait in the indexer for an earlier one, so the queues alone
+    // don't stop the reader and the other tokenizers from running ahead of a slow tokenizer.
+    // A chunk holds its slot from reading until its batch is indexed.
+    CountingSemaphore chunks_in_flight(std::max<std::size_t>(options.queue_capacity, 1) + tokenizer_count);
+
+    // The first error stops all the stages
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    const auto fail = [&](std::exception_ptr current_error) {
+        {
+            std::lock_guard guard(error_mutex);
+            if (!error) {
+                error = current_error;
+            }
+        }
+        chunks_in_flight.Cancel();
+        chunks.Cancel();
+        batches.Cancel();
+    };
+
+    std::thread reader([&] {
+        try {
+            std::size_t begin = 0;
+            while (begin < corpus.size()) {
+                std::size_t end = std::min(begin + chunk_size, corpus.size());
+                if (end < corpus.size()) {
+                    end = std::min(corpus.find('\n', end - 1), corpus.size() - 1) + 1;
+                }
+                const Chunk chunk{ corpus.substr(begin, end - begin), begin };
+                if (!chunks_in_flight.Acquire()) {
+                    break;
+                }
+                FaultPagesIn(chunk.text);
+                if (!chunks.Push(chunk)) {
+                    break;
+                }
+                begin = end;
+            }
+        }
+        catch (...) {
+            fail(std::current_exception());
+        }
+        chunks.Close();
+    });
+
+    std::atomic<std::size_t> running_tokenizers = tokenizer_count;
+    std::vector<std::thread> tokenizers;
+    tokenizers.reserve(tokenizer_count);
+    for (std::size_t i = 0; i < tokenizer_count; ++i) {
+        tokenizers.emplace_back([&] {
+            try {
+                while (const auto chunk = chunks.Pop()) {
+                    if (!batches.Push(ParseChunk(search_server, *chunk))) {
+                        break;
+                    }
+                }
+            }
+            catch (...) {
+                fail(std::current_exception());
+            }
+            if (running_tokenizers.fetch_sub(1) == 1) {
+                batches.Close();
+            }
+        });
+    }
+
+    IngestStats stats;
+    try {
+        // Tokenizers finish their chunks in any order, the documents are indexed in the order of the corpus:
+        // batches finished ahead of an earlier one wait here, at most queue_capacity + tokenizer_count of them
+        std::map<std::size_t, DocumentBatch> pending_batches;
+        std::size_t next_offset = 0;
+        while (auto batch = batches.Pop()) {
+            pending_batches.emplace(batch->offset, std::move(*batch));
+            for (auto it = pending_batches.begin(); it != pending_batches.end() && it->first == next_offset;
+                it = pending_batches.erase(it)) {
+                for (const ParsedDocument& document : it->second.documents) {
+                    try {
+                        search_server.AddDocument(document.id, document.words, document.status, document.ratings);
+                    }
+                    catch (const std::invalid_argument& e) {
+                        ThrowAtOffset(document.offset, e.what());
+                    }
+                    ++stats.documents;
+                }
+                if (it->second.error) {
+                    std::rethrow_exception(it->second.error);
+                }
+                next_offset = it->second.end;
+                chunks_in_flight.Release();
+            }
+        }
+    }
+    catch (...) {
+        fail(std::current_exception());
+    }
+
+    reader.join();
+    for (std::thread& tokenizer : tokenizers) {
+        tokenizer.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    stats.bytes = corpus.size();
+    return stats;
+}
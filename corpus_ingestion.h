@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "search_server.h"
+
+// Read-only memory mapping of a whole file
+class MappedFile {
+public:
+    // Throws system_error if the file can't be opened or mapped
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::string_view GetData() const;
+
+private:
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+struct IngestOptions {
+    std::size_t chunk_size = 4 * 1024 * 1024; // bytes of the corpus a tokenizer takes at once
+    std::size_t tokenizer_count = 0;          // 0 - one per hardware thread not taken by the reader and the indexer
+    std::size_t queue_capacity = 8;           // chunks in flight between two stages
+};
+
+struct IngestStats {
+    std::size_t documents = 0;
+    std::size_t bytes = 0;
+};
+
+// Loads a corpus with one document per line:
+//   id <TAB> status <TAB> ratings <TAB> text
+// status is ACTUAL, IRRELEVANT, BANNED or REMOVED, ratings are integers separated by spaces (may be none).
+// Empty lines are skipped.
+//
+// Three stages run concurrently: the reader cuts the corpus into chunks of whole lines and faults their pages in,
+// the tokenizers parse the lines into words and the indexer (the calling thread) adds the documents.
+// Stages are connected by bounded queues and at most queue_capacity + tokenizer_count chunks are in flight,
+// so the reader never gets more than a few chunks ahead of the indexer, even behind a slow tokenizer.
+// Words are string_views into the corpus up to the indexer, the text is copied only into the index.
+// Documents are added in the order of the corpus, whatever the number of tokenizers.
+//
+// Throws invalid_argument for the first malformed line or document rejected by AddDocument, telling the byte offset
+// of the line. The documents before that line stay in the server, as with a sequential load.
+IngestStats IngestCorpusFile(SearchServer& search_server, const std::string& path, const IngestOptions& options = {});
+
+// The same for a corpus already in memory
+IngestStats IngestCorpus(SearchServer& search_server, std::string_view corpus, const IngestOptions& options = {});
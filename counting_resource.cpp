@@ -0,0 +1,30 @@
+#include "counting_resource.h"
+
+CountingResource::CountingResource(std::pmr::memory_resource* upstream)
+    : upstream_(upstream) {
+}
+
+std::size_t CountingResource::GetAllocatedBytes() const {
+    return allocated_bytes_.load(std::memory_order_relaxed);
+}
+
+std::size_t CountingResource::GetAllocationCount() const {
+    return allocation_count_.load(std::memory_order_relaxed);
+}
+
+void* CountingResource::do_allocate(std::size_t bytes, std::size_t alignment) {
+    void* ptr = upstream_->allocate(bytes, alignment);
+    allocated_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    allocation_count_.fetch_add(1, std::memory_order_relaxed);
+    return ptr;
+}
+
+void CountingResource::do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) {
+    upstream_->deallocate(ptr, bytes, alignment);
+    allocated_bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+    allocation_count_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+bool CountingResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
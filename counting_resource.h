@@ -0,0 +1,26 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+
+// Forwards to the upstream resource and counts the memory currently allocated through it.
+// The counters are atomic, so the resource may be shared by containers changed from several threads,
+// and they may be read at any time.
+class CountingResource : public std::pmr::memory_resource {
+public:
+    explicit CountingResource(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+
+    // Bytes requested by the live allocations, without the overhead of the upstream
+    std::size_t GetAllocatedBytes() const;
+    std::size_t GetAllocationCount() const;
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    std::pmr::memory_resource* upstream_;
+    std::atomic<std::size_t> allocated_bytes_ = 0;
+    std::atomic<std::size_t> allocation_count_ = 0;
+};
@@ -1,5 +1,9 @@
 #include "document.h"
 
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+
 using namespace std::string_literals;
 
 Document::Document(int id, double relevance, int rating)
@@ -8,10 +12,33 @@ Document::Document(int id, double relevance, int rating)
     , rating(rating) {
 }
 
+bool IsValidDocumentStatus(DocumentStatus status) {
+    return static_cast<int>(status) >= 0 && static_cast<int>(status) < DOCUMENT_STATUS_COUNT;
+}
+
 std::ostream& operator<<(std::ostream& out, const Document& document) {
     out << "{ "s
         << "document_id = "s << document.id << ", "s
         << "relevance = "s << document.relevance << ", "s
         << "rating = "s << document.rating << " }"s;
     return out;
-}
\ No newline at end of file
+}
+
+std::string EncodeSearchCursor(const Document& document) {
+    // Hexadecimal floating point keeps the relevance exact, so it rounds to the same ordering key
+    char buffer[128];
+    std::snprintf(buffer, sizeof(buffer), "%a;%d;%d", document.relevance, document.rating, document.id);
+    return buffer;
+}
+
+Document DecodeSearchCursor(std::string_view cursor) {
+    const std::string text(cursor);
+    Document document;
+    char* end = nullptr;
+    document.relevance = std::strtod(text.c_str(), &end);
+    if (end == text.c_str() || *end != ';'
+        || std::sscanf(end + 1, "%d;%d", &document.rating, &document.id) != 2) {
+        throw std::invalid_argument("Search cursor ["s + text + "] is invalid"s);
+    }
+    return document;
+}
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <iostream>
+#include <string>
+#include <string_view>
 
 enum class DocumentStatus {
     ACTUAL,
@@ -9,6 +11,11 @@ enum class DocumentStatus {
     REMOVED,
 };
 
+const int DOCUMENT_STATUS_COUNT = 4;
+
+// False for a value cast from an integer outside the enumerators, e.g. read from the wire
+bool IsValidDocumentStatus(DocumentStatus status);
+
 struct Document {
     Document() = default;
 
@@ -18,4 +25,8 @@ struct Document {
     int rating = 0;
 };
 
-std::ostream& operator<<(std::ostream& out, const Document& document);
\ No newline at end of file
+std::ostream& operator<<(std::ostream& out, const Document& document);
+
+// Opaque position in the result order, used to continue a search after the given document
+std::string EncodeSearchCursor(const Document& document);
+Document DecodeSearchCursor(std::string_view cursor);
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+// Set of document ids stored as a sparse bitmap: only the blocks of BLOCK_BITS ids holding at least
+// one document are kept, sorted by their position. Memory and the cost of the set operations follow
+// the number of documents, not the largest id: a lone id takes one block, dense ids take about a bit each.
+class DocumentBitmap {
+public:
+    explicit DocumentBitmap(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : keys_(resource)
+        , blocks_(resource) {
+    }
+
+    // Copies take the memory resource of the target, not of the source
+    DocumentBitmap(const DocumentBitmap& other, std::pmr::memory_resource* resource)
+        : keys_(other.keys_, resource)
+        , blocks_(other.blocks_, resource) {
+    }
+
+    void Set(int document_id) {
+        const int key = GetKey(document_id);
+        // Ids mostly come in increasing order, which appends
+        if (keys_.empty() || keys_.back() < key) {
+            keys_.push_back(key);
+            blocks_.emplace_back();
+            SetBit(blocks_.back(), document_id);
+            return;
+        }
+        const auto it = std::lower_bound(keys_.begin(), keys_.end(), key);
+        const std::size_t index = it - keys_.begin();
+        if (*it != key) {
+            keys_.insert(it, key);
+            blocks_.emplace(blocks_.begin() + index);
+        }
+        SetBit(blocks_[index], document_id);
+    }
+
+    void Reset(int document_id) {
+        const std::size_t index = FindBlock(GetKey(document_id));
+        if (document_id < 0 || index == keys_.size()) {
+            return;
+        }
+        blocks_[index][GetBit(document_id) / 64] &= ~(1ULL << (GetBit(document_id) % 64));
+        if (IsEmpty(blocks_[index])) {
+            keys_.erase(keys_.begin() + index);
+            blocks_.erase(blocks_.begin() + index);
+        }
+    }
+
+    bool Test(int document_id) const {
+        const std::size_t index = FindBlock(GetKey(document_id));
+        return document_id >= 0 && index < keys_.size() && (blocks_[index][GetBit(document_id) / 64] >> (GetBit(document_id) % 64)) & 1;
+    }
+
+    // Keeps only the ids in [min_id, max_id]
+    void KeepRange(int min_id, int max_id) {
+        std::size_t kept = 0;
+        for (std::size_t index = 0; index < keys_.size(); ++index) {
+            const long long first_id = static_cast<long long>(keys_[index]) * BLOCK_BITS;
+            const long long last_id = first_id + BLOCK_BITS - 1;
+            if (last_id < min_id || first_id > max_id) {
+                continue;
+            }
+            Block block = blocks_[index];
+            if (first_id < min_id || last_id > max_id) {
+                for (int bit = 0; bit < BLOCK_BITS; ++bit) {
+                    if (first_id + bit < min_id || first_id + bit > max_id) {
+                        block[bit / 64] &= ~(1ULL << (bit % 64));
+                    }
+                }
+                if (IsEmpty(block)) {
+                    continue;
+                }
+            }
+            keys_[kept] = keys_[index];
+            blocks_[kept] = block;
+            ++kept;
+        }
+        keys_.resize(kept);
+        blocks_.resize(kept);
+    }
+
+    DocumentBitmap& operator&=(const DocumentBitmap& other) {
+        std::size_t kept = 0;
+        std::size_t other_index = 0;
+        for (std::size_t index = 0; index < keys_.size(); ++index) {
+            while (other_index < other.keys_.size() && other.keys_[other_index] < keys_[index]) {
+                ++other_index;
+            }
+            if (other_index == other.keys_.size()) {
+                break;
+            }
+            if (other.keys_[other_index] != keys_[index]) {
+                continue;
+            }
+            Block block = blocks_[index];
+            for (int word = 0; word < WORDS_PER_BLOCK; ++word) {
+                block[word] &= other.blocks_[other_index][word];
+            }
+            if (!IsEmpty(block)) {
+                keys_[kept] = keys_[index];
+                blocks_[kept] = block;
+                ++kept;
+            }
+        }
+        keys_.resize(kept);
+        blocks_.resize(kept);
+        return *this;
+    }
+
+    DocumentBitmap& operator|=(const DocumentBitmap& other) {
+        if (other.keys_.empty()) {
+            return *this;
+        }
+        std::pmr::vector<int> keys(keys_.get_allocator());
+        std::pmr::vector<Block> blocks(blocks_.get_allocator());
+        keys.reserve(keys_.size() + other.keys_.size());
+        blocks.reserve(keys_.size() + other.keys_.size());
+        std::size_t index = 0;
+        std::size_t other_index = 0;
+        while (index < keys_.size() || other_index < other.keys_.size()) {
+            if (other_index == other.keys_.size() || (index < keys_.size() && keys_[index] < other.keys_[other_index])) {
+                keys.push_back(keys_[index]);
+                blocks.push_back(blocks_[index++]);
+            }
+            else if (index == keys_.size() || other.keys_[other_index] < keys_[index]) {
+                keys.push_back(other.keys_[other_index]);
+                blocks.push_back(other.blocks_[other_index++]);
+            }
+            else {
+                Block block = blocks_[index++];
+                for (int word = 0; word < WORDS_PER_BLOCK; ++word) {
+                    block[word] |= other.blocks_[other_index][word];
+                }
+                keys.push_back(other.keys_[other_index++]);
+                blocks.push_back(block);
+            }
+        }
+        keys_ = std::move(keys);
+        blocks_ = std::move(blocks);
+        return *this;
+    }
+
+    std::size_t Count() const {
+        std::size_t count = 0;
+        for (const Block& block : blocks_) {
+            for (std::uint64_t word : block) {
+                for (; word; word &= word - 1) {
+                    ++count;
+                }
+            }
+        }
+        return count;
+    }
+
+    // Ids in increasing order
+    std::pmr::vector<int> GetIds(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) const {
+        std::pmr::vector<int> ids(resource);
+        ids.reserve(Count());
+        for (std::size_t index = 0; index < keys_.size(); ++index) {
+            for (int word = 0; word < WORDS_PER_BLOCK; ++word) {
+                for (std::uint64_t bits = blocks_[index][word]; bits; bits &= bits - 1) {
+                    int bit = 0;
+                    while (!((bits >> bit) & 1)) {
+                        ++bit;
+                    }
+                    ids.push_back(keys_[index] * BLOCK_BITS + word * 64 + bit);
+                }
+            }
+        }
+        return ids;
+    }
+
+private:
+    static const int BLOCK_BITS = 512;
+    static const int WORDS_PER_BLOCK = BLOCK_BITS / 64;
+
+    using Block = std::array<std::uint64_t, WORDS_PER_BLOCK>;
+
+    std::pmr::vector<int> keys_;     // document id / BLOCK_BITS, increasing
+    std::pmr::vector<Block> blocks_; // bits of the ids of the key with the same index
+
+    static int GetKey(int document_id) {
+        return document_id / BLOCK_BITS;
+    }
+
+    static int GetBit(int document_id) {
+        return document_id % BLOCK_BITS;
+    }
+
+    static void SetBit(Block& block, int document_id) {
+        block[GetBit(document_id) / 64] |= 1ULL << (GetBit(document_id) % 64);
+    }
+
+    static bool IsEmpty(const Block& block) {
+        return std::all_of(block.begin(), block.end(), [](std::uint64_t word) {
+            return word == 0;
+        });
+    }
+
+    // Index of the block of the key, keys_.size() if there is none
+    std::size_t FindBlock(int key) const {
+        const auto it = std::lower_bound(keys_.begin(), keys_.end(), key);
+        return it != keys_.end() && *it == key ? static_cast<std::size_t>(it - keys_.begin()) : keys_.size();
+    }
+};
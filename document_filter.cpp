@@ -0,0 +1,64 @@
+#include "document_filter.h"
+
+#include <algorithm>
+
+DocumentFilter DocumentFilter::WithStatus(std::initializer_list<DocumentStatus> statuses) {
+    DocumentFilter filter;
+    filter.kind_ = Kind::STATUS;
+    for (const DocumentStatus status : statuses) {
+        filter.status_mask_ |= 1u << static_cast<int>(status);
+    }
+    return filter;
+}
+
+DocumentFilter DocumentFilter::RatingRange(int min_rating, int max_rating) {
+    DocumentFilter filter;
+    filter.kind_ = Kind::RATING_RANGE;
+    filter.min_ = min_rating;
+    filter.max_ = max_rating;
+    return filter;
+}
+
+DocumentFilter DocumentFilter::IdRange(int min_id, int max_id) {
+    DocumentFilter filter;
+    filter.kind_ = Kind::ID_RANGE;
+    filter.min_ = min_id;
+    filter.max_ = max_id;
+    return filter;
+}
+
+DocumentFilter DocumentFilter::And(std::vector<DocumentFilter> filters) {
+    DocumentFilter filter;
+    filter.kind_ = Kind::AND;
+    filter.children_ = std::move(filters);
+    return filter;
+}
+
+DocumentFilter DocumentFilter::Or(std::vector<DocumentFilter> filters) {
+    DocumentFilter filter;
+    filter.kind_ = Kind::OR;
+    filter.children_ = std::move(filters);
+    return filter;
+}
+
+bool DocumentFilter::Matches(int document_id, DocumentStatus status, int rating) const {
+    switch (kind_) {
+    case Kind::ANY:
+        return true;
+    case Kind::STATUS:
+        return HasStatus(status);
+    case Kind::RATING_RANGE:
+        return rating >= min_ && rating <= max_;
+    case Kind::ID_RANGE:
+        return document_id >= min_ && document_id <= max_;
+    case Kind::AND:
+        return std::all_of(children_.begin(), children_.end(), [&](const DocumentFilter& child) {
+            return child.Matches(document_id, status, rating);
+            });
+    case Kind::OR:
+        return std::any_of(children_.begin(), children_.end(), [&](const DocumentFilter& child) {
+            return child.Matches(document_id, status, rating);
+            });
+    }
+    return false;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <climits>
+#include <initializer_list>
+#include <vector>
+
+#include "document.h"
+
+// Declarative filter of documents by status, rating and id.
+// Unlike a predicate lambda, SearchServer can evaluate it with its secondary indexes
+// before scanning postings.
+//     DocumentFilter::And({ DocumentFilter::WithStatus({ DocumentStatus::ACTUAL }), DocumentFilter::RatingRange(4, INT_MAX) })
+class DocumentFilter {
+public:
+    enum class Kind {
+        ANY,
+        STATUS,
+        RATING_RANGE,
+        ID_RANGE,
+        AND,
+        OR,
+    };
+
+    // Matches every document
+    DocumentFilter() = default;
+
+    static DocumentFilter WithStatus(std::initializer_list<DocumentStatus> statuses);
+
+    // Bounds are inclusive
+    static DocumentFilter RatingRange(int min_rating, int max_rating);
+    static DocumentFilter IdRange(int min_id, int max_id);
+
+    static DocumentFilter And(std::vector<DocumentFilter> filters);
+    static DocumentFilter Or(std::vector<DocumentFilter> filters);
+
+    bool Matches(int document_id, DocumentStatus status, int rating) const;
+
+    Kind GetKind() const {
+        return kind_;
+    }
+
+    bool HasStatus(DocumentStatus status) const {
+        return (status_mask_ >> static_cast<int>(status)) & 1;
+    }
+
+    int GetMin() const {
+        return min_;
+    }
+
+    int GetMax() const {
+        return max_;
+    }
+
+    const std::vector<DocumentFilter>& GetChildren() const {
+        return children_;
+    }
+
+private:
+    Kind kind_ = Kind::ANY;
+    unsigned status_mask_ = 0;
+    int min_ = INT_MIN;
+    int max_ = INT_MAX;
+    std::vector<DocumentFilter> children_;
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <random>
+#include <string>
+#include <vector>
+
+// Random corpora and queries for benchmarks. Every generator is driven by the passed
+// std::mt19937, so the same seed always gives the same corpus.
+
+std::string GenerateWord(std::mt19937& generator, int max_length);
+
+std::vector<std::string> GenerateDictionary(std::mt19937& generator, int word_count, int max_length);
+
+std::string GenerateQuery(std::mt19937& generator, const std::vector<std::string>& dictionary, int word_count, double minus_prob = 0);
+
+std::vector<std::string> GenerateQueries(std::mt19937& generator, const std::vector<std::string>& dictionary, int query_count, int max_word_count);
+
+// Picks ranks 0..n-1 with probability proportional to 1 / (rank + 1)^exponent.
+// exponent == 0 is the uniform distribution, natural language text is close to 1.
+class ZipfDistribution {
+public:
+    ZipfDistribution(int n, double exponent);
+
+    int operator()(std::mt19937& generator) const;
+
+private:
+    std::vector<double> cumulative_weights_;
+};
+
+std::string GenerateZipfQuery(std::mt19937& generator, const std::vector<std::string>& dictionary, const ZipfDistribution& distribution,
+    int word_count, double minus_prob = 0);
+
+std::vector<std::string> GenerateZipfQueries(std::mt19937& generator, const std::vector<std::string>& dictionary, const ZipfDistribution& distribution,
+    int query_count, int word_count, double minus_prob = 0);
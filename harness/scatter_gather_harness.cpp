@@ -0,0 +1,156 @@
+// Checks a sharded index against a single SearchServer holding the same corpus.
+//
+// Forks one shard server process per shard, serving on Unix domain sockets, loads a reproducible corpus
+// through a ShardCoordinator and a single server and compares the results of the same queries:
+// ids, ratings and relevances must be exactly equal. Exits with 1 on any difference.
+//
+// Build it from the sources of the server, e.g.
+//   g++ -std=c++17 -O2 -I.. scatter_gather_harness.cpp ../document.cpp ../generators.cpp ../metrics.cpp ../positions.cpp
+//       ../query_arena.cpp ../counting_resource.cpp ../search_server.cpp ../shard_coordinator.cpp ../shard_protocol.cpp ../shard_transport.cpp
+//       ../stop_words.cpp ../string_processing.cpp -ltbb -lpthread -o scatter_gather_harness
+//
+// Usage: ./scatter_gather_harness [shard_count] [document_count]
+
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "generators.h"
+#include "search_server.h"
+#include "shard_coordinator.h"
+#include "shard_transport.h"
+
+using namespace std::string_literals;
+
+namespace {
+
+const int VOCABULARY_SIZE = 2'000;
+const int MAX_WORD_LENGTH = 10;
+const int DOCUMENT_WORD_COUNT = 50;
+const int QUERY_COUNT = 200;
+const int QUERY_WORD_COUNT = 6;
+const double MINUS_WORD_PROB = 0.1;
+const unsigned SEED = 42;
+
+bool AreSameResults(const std::vector<Document>& expected, const std::vector<Document>& actual) {
+    if (expected.size() != actual.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+        if (expected[i].id != actual[i].id || expected[i].rating != actual[i].rating
+            || expected[i].relevance != actual[i].relevance) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void PrintResults(const std::string& title, const std::vector<Document>& documents) {
+    std::cerr << "  "s << title << ":"s << std::endl;
+    for (const Document& document : documents) {
+        std::cerr << "    "s << document << std::endl;
+    }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    const int shard_count = argc > 1 ? std::atoi(argv[1]) : 3;
+    const int document_count = argc > 2 ? std::atoi(argv[2]) : 5'000;
+    if (shard_count <= 0 || document_count < 0) {
+        std::cerr << "Usage: "s << argv[0] << " [shard_count] [document_count]"s << std::endl;
+        return 2;
+    }
+
+    std::mt19937 generator(SEED);
+    const auto dictionary = GenerateDictionary(generator, VOCABULARY_SIZE, MAX_WORD_LENGTH);
+    const ZipfDistribution distribution(static_cast<int>(dictionary.size()), 1.0);
+    const auto documents = GenerateZipfQueries(generator, dictionary, distribution, document_count, DOCUMENT_WORD_COUNT);
+    auto queries = GenerateZipfQueries(generator, dictionary, distribution, QUERY_COUNT, QUERY_WORD_COUNT, MINUS_WORD_PROB);
+    // Expanded and required words get their statistics from the shards where they occur
+    queries.push_back(dictionary[1].substr(0, 2) + "* "s + dictionary[2]);
+    queries.push_back(dictionary[3] + "~1 "s + dictionary[4]);
+    queries.push_back("+"s + dictionary[5] + " "s + dictionary[6]);
+
+    // Shards are forked before any thread is started
+    std::vector<std::string> socket_paths;
+    std::vector<pid_t> shard_pids;
+    for (int i = 0; i < shard_count; ++i) {
+        socket_paths.push_back("/tmp/search_server_shard_"s + std::to_string(getpid()) + "_"s + std::to_string(i) + ".sock"s);
+        const pid_t pid = fork();
+        if (pid < 0) {
+            std::cerr << "Can't start shard "s << i << std::endl;
+            return 1;
+        }
+        if (pid == 0) {
+            try {
+                SearchServer shard(dictionary[0]);
+                ServeShard(shard, socket_paths.back());
+                std::_Exit(0);
+            }
+            catch (const std::exception& e) {
+                std::cerr << "Shard "s << i << ": "s << e.what() << std::endl;
+                std::_Exit(1);
+            }
+        }
+        shard_pids.push_back(pid);
+    }
+
+    int mismatch_count = 0;
+    try {
+        std::vector<std::unique_ptr<ShardTransport>> transports;
+        for (const std::string& socket_path : socket_paths) {
+            transports.push_back(std::make_unique<UnixSocketShardTransport>(socket_path));
+        }
+        ShardCoordinator coordinator(std::move(transports));
+        SearchServer single_server(dictionary[0]);
+
+        for (int id = 0; id < document_count; ++id) {
+            const DocumentStatus status = id % 10 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+            const std::vector<int> ratings = { id % 7 - 3, id % 5 };
+            coordinator.AddDocument(id, documents[id], status, ratings);
+            single_server.AddDocument(id, documents[id], status, ratings);
+        }
+
+        for (const std::string& query : queries) {
+            for (const DocumentStatus status : { DocumentStatus::ACTUAL, DocumentStatus::BANNED }) {
+                const auto expected = single_server.FindTopDocuments(query, status);
+                const auto actual = coordinator.FindTopDocuments(query, status);
+                if (!AreSameResults(expected, actual)) {
+                    ++mismatch_count;
+                    std::cerr << "Results differ for query ["s << query << "], status "s << static_cast<int>(status) << std::endl;
+                    PrintResults("single server"s, expected);
+                    PrintResults("shards"s, actual);
+                }
+            }
+        }
+        coordinator.Shutdown();
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: "s << e.what() << std::endl;
+        for (const pid_t pid : shard_pids) {
+            kill(pid, SIGTERM);
+        }
+        mismatch_count = -1;
+    }
+
+    bool shards_ok = true;
+    for (const pid_t pid : shard_pids) {
+        int status = 0;
+        waitpid(pid, &status, 0);
+        shards_ok = shards_ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+    if (mismatch_count != 0 || !shards_ok) {
+        return 1;
+    }
+    std::cout << "OK: "s << shard_count << " shards, "s << document_count << " documents, "s
+        << queries.size() * 2 << " queries match the single server"s << std::endl;
+    return 0;
+}
@@ -1,5 +1,6 @@
 ﻿#include "process_queries.h"
 #include "search_server.h"
+#include "generators.h"
 
 #include <execution>
 #include <iostream>
@@ -11,51 +12,6 @@
 
 using namespace std;
 
-string GenerateWord(mt19937& generator, int max_length) {
-    const int length = uniform_int_distribution(1, max_length)(generator);
-    string word;
-    word.reserve(length);
-    const int a = 'a';
-    const int z = 'z';
-    for (int i = 0; i < length; ++i) {
-        word.push_back(uniform_int_distribution(a, z)(generator));
-    }
-    return word;
-}
-
-vector<string> GenerateDictionary(mt19937& generator, int word_count, int max_length) {
-    vector<string> words;
-    words.reserve(word_count);
-    for (int i = 0; i < word_count; ++i) {
-        words.push_back(GenerateWord(generator, max_length));
-    }
-    words.erase(unique(words.begin(), words.end()), words.end());
-    return words;
-}
-
-string GenerateQuery(mt19937& generator, const vector<string>& dictionary, int word_count, double minus_prob = 0) {
-    string query;
-    for (int i = 0; i < word_count; ++i) {
-        if (!query.empty()) {
-            query.push_back(' ');
-        }
-        if (uniform_real_distribution<>(0, 1)(generator) < minus_prob) {
-            query.push_back('-');
-        }
-        query += dictionary[uniform_int_distribution<int>(0, dictionary.size() - 1)(generator)];
-    }
-    return query;
-}
-
-vector<string> GenerateQueries(mt19937& generator, const vector<string>& dictionary, int query_count, int max_word_count) {
-    vector<string> queries;
-    queries.reserve(query_count);
-    for (int i = 0; i < query_count; ++i) {
-        queries.push_back(GenerateQuery(generator, dictionary, max_word_count));
-    }
-    return queries;
-}
-
 template <typename ExecutionPolicy>
 void TestFindTopDocs(string_view mark, const SearchServer& search_server, const vector<string>& queries, ExecutionPolicy&& policy) {
     LOG_DURATION(mark);
@@ -71,7 +27,7 @@ void TestFindTopDocs(string_view mark, const SearchServer& search_server, const
 #define TEST_FIND_TOP(policy) TestFindTopDocs(#policy, search_server, queries, execution::policy)
 
 template <typename ExecutionPolicy>
-void TestMatchDoc(string_view mark, SearchServer search_server, const string& query, ExecutionPolicy&& policy) {
+void TestMatchDoc(string_view mark, const SearchServer& search_server, const string& query, ExecutionPolicy&& policy) {
     LOG_DURATION(mark);
     const int document_count = search_server.GetDocumentCount();
     int word_count = 0;
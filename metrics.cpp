@@ -0,0 +1,166 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+std::string_view GetMetricOperationName(MetricOperation operation) {
+    switch (operation) {
+    case MetricOperation::ADD_DOCUMENT:
+        return "add_document";
+    case MetricOperation::REMOVE_DOCUMENT:
+        return "remove_document";
+    case MetricOperation::FIND_TOP_DOCUMENTS:
+        return "find_top_documents";
+    case MetricOperation::MATCH_DOCUMENT:
+        return "match_document";
+    case MetricOperation::PROCESS_QUERIES:
+        return "process_queries";
+    }
+    return "unknown";
+}
+
+int LatencyBuckets::GetIndex(std::uint64_t value) {
+    if (value < SUB_BUCKET_COUNT) {
+        return static_cast<int>(value);
+    }
+    int highest_bit = 63;
+    while (!(value >> highest_bit)) {
+        --highest_bit;
+    }
+    const int shift = highest_bit - SUB_BUCKET_BITS;
+    return ((shift + 1) << SUB_BUCKET_BITS) + static_cast<int>((value >> shift) & (SUB_BUCKET_COUNT - 1));
+}
+
+std::uint64_t LatencyBuckets::GetLowerBound(int index) {
+    if (index < SUB_BUCKET_COUNT) {
+        return index;
+    }
+    const int shift = (index >> SUB_BUCKET_BITS) - 1;
+    const std::uint64_t sub_bucket = index & (SUB_BUCKET_COUNT - 1);
+    return (SUB_BUCKET_COUNT + sub_bucket) << shift;
+}
+
+std::uint64_t HistogramSnapshot::GetPercentile(double percentile) const {
+    if (count == 0) {
+        return 0;
+    }
+    const auto rank = static_cast<std::uint64_t>(percentile * (count - 1));
+    std::uint64_t seen = 0;
+    for (int i = 0; i < LatencyBuckets::BUCKET_COUNT; ++i) {
+        seen += buckets[i];
+        if (seen > rank) {
+            return std::min(LatencyBuckets::GetLowerBound(i), max_ns);
+        }
+    }
+    return max_ns;
+}
+
+double HistogramSnapshot::GetMeanNs() const {
+    return count == 0 ? 0.0 : total_ns * 1.0 / count;
+}
+
+void HistogramSnapshot::Merge(const HistogramSnapshot& other) {
+    for (int i = 0; i < LatencyBuckets::BUCKET_COUNT; ++i) {
+        buckets[i] += other.buckets[i];
+    }
+    count += other.count;
+    total_ns += other.total_ns;
+    max_ns = std::max(max_ns, other.max_ns);
+}
+
+#if SEARCH_SERVER_METRICS
+
+namespace {
+
+// Written by a single thread, read by snapshots
+struct AtomicHistogram {
+    std::array<std::atomic<std::uint64_t>, LatencyBuckets::BUCKET_COUNT> buckets{};
+    std::atomic<std::uint64_t> count{ 0 };
+    std::atomic<std::uint64_t> total_ns{ 0 };
+    std::atomic<std::uint64_t> max_ns{ 0 };
+
+    void Record(std::uint64_t value) {
+        // Only the owner thread writes, plain load + store is enough
+        auto& bucket = buckets[LatencyBuckets::GetIndex(value)];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        total_ns.store(total_ns.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        if (value > max_ns.load(std::memory_order_relaxed)) {
+            max_ns.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    void AddTo(HistogramSnapshot& snapshot) const {
+        for (int i = 0; i < LatencyBuckets::BUCKET_COUNT; ++i) {
+            snapshot.buckets[i] += buckets[i].load(std::memory_order_relaxed);
+        }
+        snapshot.count += count.load(std::memory_order_relaxed);
+        snapshot.total_ns += total_ns.load(std::memory_order_relaxed);
+        snapshot.max_ns = std::max(snapshot.max_ns, max_ns.load(std::memory_order_relaxed));
+    }
+};
+
+using ThreadHistograms = std::array<AtomicHistogram, METRIC_OPERATION_COUNT>;
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<ThreadHistograms*> live;
+    MetricsSnapshot retired; // histograms of the finished threads
+};
+
+Registry& GetRegistry() {
+    // Never destroyed, threads may finish after static destructors have run
+    static Registry* registry = new Registry;
+    return *registry;
+}
+
+// Registers the histograms of a thread on first use, folds them into retired on thread exit
+class ThreadHistogramsHolder {
+public:
+    ThreadHistogramsHolder()
+        : histograms_(std::make_unique<ThreadHistograms>())
+    {
+        Registry& registry = GetRegistry();
+        std::lock_guard guard(registry.mutex);
+        registry.live.push_back(histograms_.get());
+    }
+
+    ~ThreadHistogramsHolder() {
+        Registry& registry = GetRegistry();
+        std::lock_guard guard(registry.mutex);
+        for (int i = 0; i < METRIC_OPERATION_COUNT; ++i) {
+            (*histograms_)[i].AddTo(registry.retired.operations[i]);
+        }
+        registry.live.erase(std::find(registry.live.begin(), registry.live.end(), histograms_.get()));
+    }
+
+    ThreadHistograms& Get() {
+        return *histograms_;
+    }
+
+private:
+    std::unique_ptr<ThreadHistograms> histograms_;
+};
+
+}  // namespace
+
+void RecordLatency(MetricOperation operation, std::uint64_t duration_ns) {
+    thread_local ThreadHistogramsHolder holder;
+    holder.Get()[static_cast<int>(operation)].Record(duration_ns);
+}
+
+MetricsSnapshot GetMetricsSnapshot() {
+    Registry& registry = GetRegistry();
+    std::lock_guard guard(registry.mutex);
+    MetricsSnapshot snapshot = registry.retired;
+    for (const ThreadHistograms* histograms : registry.live) {
+        for (int i = 0; i < METRIC_OPERATION_COUNT; ++i) {
+            (*histograms)[i].AddTo(snapshot.operations[i]);
+        }
+    }
+    return snapshot;
+}
+
+#endif
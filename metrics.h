@@ -0,0 +1,122 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Build with -DSEARCH_SERVER_METRICS=0 to compile the latency histograms out of the hot path
+#ifndef SEARCH_SERVER_METRICS
+#define SEARCH_SERVER_METRICS 1
+#endif
+
+enum class MetricOperation {
+    ADD_DOCUMENT,
+    REMOVE_DOCUMENT,
+    FIND_TOP_DOCUMENTS,
+    MATCH_DOCUMENT,
+    PROCESS_QUERIES,
+};
+
+const int METRIC_OPERATION_COUNT = 5;
+
+std::string_view GetMetricOperationName(MetricOperation operation);
+
+inline std::uint64_t GetNowNs() {
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Log-linear (HDR style) bucketing of nanoseconds:
+// values below 16 get their own bucket, every next power of two is split into 16 buckets,
+// so a bucket is at most ~6% wide
+struct LatencyBuckets {
+    static constexpr int SUB_BUCKET_BITS = 4;
+    static constexpr int SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+    static constexpr int BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+    static int GetIndex(std::uint64_t value);
+
+    // The smallest value that falls into the bucket
+    static std::uint64_t GetLowerBound(int index);
+};
+
+struct HistogramSnapshot {
+    std::vector<std::uint64_t> buckets = std::vector<std::uint64_t>(LatencyBuckets::BUCKET_COUNT);
+    std::uint64_t count = 0;
+    std::uint64_t total_ns = 0;
+    std::uint64_t max_ns = 0;
+
+    // percentile is in [0, 1], the result is the lower bound of the bucket
+    std::uint64_t GetPercentile(double percentile) const;
+
+    double GetMeanNs() const;
+
+    void Merge(const HistogramSnapshot& other);
+};
+
+struct MetricsSnapshot {
+    std::array<HistogramSnapshot, METRIC_OPERATION_COUNT> operations;
+
+    const HistogramSnapshot& Get(MetricOperation operation) const {
+        return operations[static_cast<int>(operation)];
+    }
+};
+
+#if SEARCH_SERVER_METRICS
+
+// Adds a measurement to the histogram of the calling thread.
+// Every thread writes only its own histograms, so recording takes no locks and no atomic read-modify-write.
+void RecordLatency(MetricOperation operation, std::uint64_t duration_ns);
+
+// Sums the histograms of all the threads, safe to call while other threads record
+MetricsSnapshot GetMetricsSnapshot();
+
+// Records the lifetime of the scope into the histogram of the operation
+class OperationTimer {
+public:
+    explicit OperationTimer(MetricOperation operation)
+        : operation_(operation)
+    {
+    }
+
+    ~OperationTimer() {
+        RecordLatency(operation_, GetNowNs() - start_ns_);
+    }
+
+private:
+    const MetricOperation operation_;
+    const std::uint64_t start_ns_ = GetNowNs();
+};
+
+#else
+
+inline void RecordLatency(MetricOperation, std::uint64_t) {
+}
+
+inline MetricsSnapshot GetMetricsSnapshot() {
+    return {};
+}
+
+class OperationTimer {
+public:
+    explicit OperationTimer(MetricOperation) {
+    }
+};
+
+#endif
+
+// Execution profile of a single FindTopDocuments call, filled only when requested
+struct QueryStats {
+    std::uint64_t parse_ns = 0;
+    std::uint64_t score_ns = 0;  // scanning postings, applying minus words and phrases
+    std::uint64_t sort_ns = 0;   // ordering the matched documents and cutting the top
+    std::uint64_t plus_words = 0;
+    std::uint64_t minus_words = 0;
+    std::uint64_t postings_scanned = 0;  // postings of the plus words visited, after narrowing by required words and filters
+    std::uint64_t documents_scored = 0;
+    std::uint64_t minus_word_exclusions = 0;
+    std::uint64_t phrase_exclusions = 0;
+    std::uint64_t result_count = 0;
+};
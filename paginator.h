@@ -38,34 +38,84 @@ std::ostream& operator<<(std::ostream& out, const IteratorRange<Iterator>& range
     return out;
 }
 
+// Splits a range into pages lazily: a page is computed only when it is accessed.
+// For random access iterators both the size and any page are O(1).
 template <typename Iterator>
 class Paginator {
 public:
-    Paginator(Iterator begin, Iterator end, size_t page_size) {
-        for (size_t left = std::distance(begin, end); left > 0;) {
-            const size_t current_page_size = std::min(page_size, left);
-            const Iterator current_page_end = std::next(begin, current_page_size);
-            pages_.push_back({ begin, current_page_end });
-
-            left -= current_page_size;
-            begin = current_page_end;
+    class PageIterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = IteratorRange<Iterator>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = IteratorRange<Iterator>;
+
+        PageIterator(Iterator page_begin, size_t left, size_t page_size)
+            : page_begin_(page_begin)
+            , left_(left)
+            , page_size_(page_size) {
+        }
+
+        IteratorRange<Iterator> operator*() const {
+            return { page_begin_, std::next(page_begin_, std::min(page_size_, left_)) };
+        }
+
+        PageIterator& operator++() {
+            const size_t current_page_size = std::min(page_size_, left_);
+            page_begin_ = std::next(page_begin_, current_page_size);
+            left_ -= current_page_size;
+            return *this;
+        }
+
+        bool operator==(const PageIterator& other) const {
+            return left_ == other.left_;
         }
+
+        bool operator!=(const PageIterator& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        Iterator page_begin_;
+        size_t left_;
+        size_t page_size_;
+    };
+
+    Paginator(Iterator begin, Iterator end, size_t page_size)
+        : begin_(begin)
+        , end_(end)
+        , page_size_(std::max<size_t>(page_size, 1))
+        , item_count_(std::distance(begin, end)) {
     }
 
-    auto begin() const {
-        return pages_.begin();
+    PageIterator begin() const {
+        return { begin_, item_count_, page_size_ };
     }
 
-    auto end() const {
-        return pages_.end();
+    PageIterator end() const {
+        return { end_, 0, page_size_ };
     }
 
     size_t size() const {
-        return pages_.size();
+        return (item_count_ + page_size_ - 1) / page_size_;
+    }
+
+    // page_index must be less than size()
+    IteratorRange<Iterator> GetPage(size_t page_index) const {
+        const size_t page_offset = page_index * page_size_;
+        const Iterator page_begin = std::next(begin_, page_offset);
+        return { page_begin, std::next(page_begin, std::min(page_size_, item_count_ - page_offset)) };
+    }
+
+    IteratorRange<Iterator> operator[](size_t page_index) const {
+        return GetPage(page_index);
     }
 
 private:
-    std::vector<IteratorRange<Iterator>> pages_;
+    Iterator begin_, end_;
+    size_t page_size_;
+    size_t item_count_;
 };
 
 template <typename Container>
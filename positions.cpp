@@ -0,0 +1,81 @@
+#include "positions.h"
+
+#include <algorithm>
+
+void PositionList::Add(int position) {
+    auto delta = static_cast<std::uint32_t>(position - last_position_);
+    last_position_ = position;
+    while (delta >= 0x80) {
+        data_.push_back(static_cast<std::uint8_t>(delta | 0x80));
+        delta >>= 7;
+    }
+    data_.push_back(static_cast<std::uint8_t>(delta));
+}
+
+void PositionList::Decode(std::pmr::vector<int>& positions) const {
+    positions.clear();
+    int position = 0;
+    std::uint32_t delta = 0;
+    int shift = 0;
+    for (const std::uint8_t byte : data_) {
+        delta |= static_cast<std::uint32_t>(byte & 0x7F) << shift;
+        if (byte & 0x80) {
+            shift += 7;
+            continue;
+        }
+        position += static_cast<int>(delta);
+        positions.push_back(position);
+        delta = 0;
+        shift = 0;
+    }
+}
+
+std::size_t PositionList::GetByteSize() const {
+    return data_.size();
+}
+
+int CountPhraseMatches(const std::pmr::vector<std::pmr::vector<int>>& word_positions, const std::pmr::vector<int>& offsets, int slop, int max_count) {
+    if (offsets.empty()) {
+        return max_count > 0 ? 1 : 0;
+    }
+
+    int count = 0;
+    if (slop == 0) {
+        // Drive the check by the rarest word, the others are probed with binary search
+        std::size_t rarest = 0;
+        for (std::size_t i = 1; i < offsets.size(); ++i) {
+            if (word_positions[i].size() < word_positions[rarest].size()) {
+                rarest = i;
+            }
+        }
+        for (const int position : word_positions[rarest]) {
+            const int start = position - offsets[rarest];
+            bool matched = true;
+            for (std::size_t i = 0; i < offsets.size() && matched; ++i) {
+                matched = std::binary_search(word_positions[i].begin(), word_positions[i].end(), start + offsets[i]);
+            }
+            if (matched && ++count >= max_count) {
+                break;
+            }
+        }
+        return count;
+    }
+
+    // Taking the earliest position of every next word gives the shortest match for a given start
+    const long long max_span = static_cast<long long>(offsets.back()) - offsets.front() + slop;
+    for (const int start : word_positions.front()) {
+        int last = start;
+        bool matched = true;
+        for (std::size_t i = 1; i < offsets.size() && matched; ++i) {
+            const auto it = std::upper_bound(word_positions[i].begin(), word_positions[i].end(), last);
+            matched = it != word_positions[i].end() && *it - start <= max_span;
+            if (matched) {
+                last = *it;
+            }
+        }
+        if (matched && ++count >= max_count) {
+            break;
+        }
+    }
+    return count;
+}
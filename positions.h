@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+// Positions of a word inside a document.
+// Stored as deltas between neighbouring positions, each delta is varint encoded,
+// so a typical position takes a single byte.
+class PositionList {
+public:
+    using allocator_type = std::pmr::polymorphic_allocator<std::uint8_t>;
+
+    PositionList() = default;
+
+    explicit PositionList(const allocator_type& allocator)
+        : data_(allocator) {
+    }
+
+    PositionList(const PositionList& other, const allocator_type& allocator)
+        : data_(other.data_, allocator)
+        , last_position_(other.last_position_) {
+    }
+
+    PositionList(PositionList&& other, const allocator_type& allocator)
+        : data_(std::move(other.data_), allocator)
+        , last_position_(other.last_position_) {
+    }
+
+    // Positions must be added in increasing order
+    void Add(int position);
+
+    // Replaces the content of positions, reusing its memory
+    void Decode(std::pmr::vector<int>& positions) const;
+
+    std::size_t GetByteSize() const;
+
+private:
+    std::pmr::vector<std::uint8_t> data_;
+    int last_position_ = 0;
+};
+
+// Counts the places where the words occur in the given order with the given offsets, up to max_count.
+// word_positions[i] are the sorted positions of the i-th word, offsets[i] is its offset inside the phrase;
+// the phrase has offsets.size() words, further word_positions are ignored.
+// With slop == 0 the offsets must match exactly, otherwise the words must keep their order
+// and the whole match may be up to slop positions longer than the phrase.
+int CountPhraseMatches(const std::pmr::vector<std::pmr::vector<int>>& word_positions, const std::pmr::vector<int>& offsets, int slop,
+    int max_count = std::numeric_limits<int>::max());
+
+inline bool HasPhraseMatch(const std::pmr::vector<std::pmr::vector<int>>& word_positions, const std::pmr::vector<int>& offsets, int slop) {
+    return CountPhraseMatches(word_positions, offsets, slop, 1) > 0;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+// Posting lists are maps from document id to term frequency (std::pmr::map<int, double>).
+// Maps have no random access, so "skipping" in a list is a tree lookup: O(log N) instead of a linear walk.
+
+// Returns the first index in [from, ids.size()) with ids[index] >= id.
+// Gallops with doubling steps and finishes with binary search, so the cost depends on the distance, not on the size.
+template <typename IdList>
+std::size_t GallopTo(const IdList& ids, std::size_t from, int id) {
+    std::size_t step = 1;
+    std::size_t bound = from;
+    while (bound < ids.size() && ids[bound] < id) {
+        from = bound + 1;
+        bound += step;
+        step *= 2;
+    }
+    return std::lower_bound(ids.begin() + from, ids.begin() + std::min(bound, ids.size()), id) - ids.begin();
+}
+
+// True if probing every id of a list of size small in a tree of size large is cheaper than walking both
+inline bool ShouldProbe(std::size_t small, std::size_t large) {
+    return small * std::log2(large + 2.0) < static_cast<double>(small + large);
+}
+
+// Ids of the documents present in every list. Lists are processed rarest first,
+// so the cost is driven by the rarest list: the candidates only shrink,
+// and every next list is probed by tree lookups while the candidates are few.
+// The result is allocated from the resource of lists.
+template <typename PostingList>
+std::pmr::vector<int> IntersectPostingLists(std::pmr::vector<const PostingList*> lists) {
+    std::pmr::vector<int> candidates(lists.get_allocator());
+    if (lists.empty()) {
+        return candidates;
+    }
+    std::sort(lists.begin(), lists.end(), [](const PostingList* lhs, const PostingList* rhs) {
+        return lhs->size() < rhs->size();
+    });
+
+    candidates.reserve(lists.front()->size());
+    for (const auto& [document_id, _] : *lists.front()) {
+        candidates.push_back(document_id);
+    }
+
+    for (std::size_t i = 1; i < lists.size() && !candidates.empty(); ++i) {
+        const PostingList& list = *lists[i];
+        auto last = candidates.begin();
+        if (ShouldProbe(candidates.size(), list.size())) {
+            for (const int document_id : candidates) {
+                if (list.count(document_id) > 0) {
+                    *last++ = document_id;
+                }
+            }
+        }
+        else {
+            std::size_t position = 0;
+            for (auto it = list.begin(); it != list.end() && position < candidates.size(); ++it) {
+                position = GallopTo(candidates, position, it->first);
+                if (position < candidates.size() && candidates[position] == it->first) {
+                    *last++ = it->first;
+                    ++position;
+                }
+            }
+        }
+        candidates.erase(last, candidates.end());
+    }
+    return candidates;
+}
+
+// Calls callback(document_id, term_freq) for the postings of the documents in candidates
+// (sorted ids), or for all the postings if candidates is null
+template <typename PostingList, typename IdList, typename Callback>
+void ForEachPosting(const PostingList& postings, const IdList* candidates, Callback callback) {
+    if (!candidates) {
+        for (const auto& [document_id, term_freq] : postings) {
+            callback(document_id, term_freq);
+        }
+        return;
+    }
+
+    if (ShouldProbe(candidates->size(), postings.size())) {
+        for (const int document_id : *candidates) {
+            if (const auto it = postings.find(document_id); it != postings.end()) {
+                callback(document_id, it->second);
+            }
+        }
+        return;
+    }
+
+    std::size_t position = 0;
+    for (const auto& [document_id, term_freq] : postings) {
+        position = GallopTo(*candidates, position, document_id);
+        if (position == candidates->size()) {
+            break;
+        }
+        if ((*candidates)[position] == document_id) {
+            callback(document_id, term_freq);
+        }
+    }
+}
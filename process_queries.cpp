@@ -5,6 +5,7 @@
 std::vector<std::vector<Document>> ProcessQueries(
     const SearchServer& search_server,
     const std::vector<std::string>& queries) {
+    OperationTimer timer(MetricOperation::PROCESS_QUERIES);
 
     std::vector<std::vector<Document>> results(queries.size());
     results.reserve(queries.size());
@@ -0,0 +1,99 @@
+#include "query_arena.h"
+
+#include <algorithm>
+#include <memory>
+
+namespace {
+
+const std::size_t INITIAL_BUFFER_SIZE = 64 * 1024;
+// Every thread keeps its buffer for good, so a few huge queries must not pin their memory:
+// queries needing more than this take the rest from the heap
+const std::size_t MAX_BUFFER_SIZE = 4 * 1024 * 1024;
+
+struct ThreadBuffer {
+    std::unique_ptr<std::byte[]> data;
+    std::size_t size = 0;
+    bool in_use = false;
+};
+
+thread_local ThreadBuffer thread_buffer;
+
+}  // namespace
+
+SynchronizedResource::SynchronizedResource(std::pmr::memory_resource* upstream)
+    : upstream_(upstream) {
+}
+
+void* SynchronizedResource::do_allocate(std::size_t bytes, std::size_t alignment) {
+    std::lock_guard guard(mutex_);
+    return upstream_->allocate(bytes, alignment);
+}
+
+void SynchronizedResource::do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) {
+    std::lock_guard guard(mutex_);
+    upstream_->deallocate(ptr, bytes, alignment);
+}
+
+bool SynchronizedResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+std::size_t QueryArena::OverflowResource::GetOverflowBytes() const {
+    return overflow_bytes_;
+}
+
+void* QueryArena::OverflowResource::do_allocate(std::size_t bytes, std::size_t alignment) {
+    overflow_bytes_ += bytes;
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+}
+
+void QueryArena::OverflowResource::do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) {
+    std::pmr::new_delete_resource()->deallocate(ptr, bytes, alignment);
+}
+
+bool QueryArena::OverflowResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+QueryArena::QueryArena() {
+    if (!thread_buffer.in_use) {
+        if (!thread_buffer.data) {
+            thread_buffer.data = std::make_unique<std::byte[]>(INITIAL_BUFFER_SIZE);
+            thread_buffer.size = INITIAL_BUFFER_SIZE;
+        }
+        thread_buffer.in_use = true;
+        owns_thread_buffer_ = true;
+        resource_.emplace(thread_buffer.data.get(), thread_buffer.size, &overflow_);
+    }
+    else {
+        resource_.emplace(&overflow_);
+    }
+    synchronized_resource_.emplace(&*resource_);
+}
+
+QueryArena::~QueryArena() {
+    synchronized_resource_.reset();
+    resource_.reset();
+    if (!owns_thread_buffer_) {
+        return;
+    }
+    // Next queries of the thread should fit into the buffer
+    const std::size_t overflow_bytes = overflow_.GetOverflowBytes();
+    if (overflow_bytes > 0 && thread_buffer.size < MAX_BUFFER_SIZE) {
+        std::size_t size = thread_buffer.size;
+        while (size < thread_buffer.size + overflow_bytes && size < MAX_BUFFER_SIZE) {
+            size *= 2;
+        }
+        thread_buffer.data = std::make_unique<std::byte[]>(std::min(size, MAX_BUFFER_SIZE));
+        thread_buffer.size = std::min(size, MAX_BUFFER_SIZE);
+    }
+    thread_buffer.in_use = false;
+}
+
+std::pmr::memory_resource* QueryArena::GetResource() {
+    return &*resource_;
+}
+
+std::pmr::memory_resource* QueryArena::GetSynchronizedResource() {
+    return &*synchronized_resource_;
+}
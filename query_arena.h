@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+
+// Forwards to an upstream resource under a mutex, so that several threads may share it
+class SynchronizedResource : public std::pmr::memory_resource {
+public:
+    explicit SynchronizedResource(std::pmr::memory_resource* upstream);
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    std::pmr::memory_resource* upstream_;
+    std::mutex mutex_;
+};
+
+// Memory for the temporary containers of a single query.
+// Every thread keeps one buffer reused by its queries: allocations bump a pointer in it
+// and all of them are released at once when the arena is destroyed.
+// A query that runs out of the buffer takes the rest from the heap, and the buffer grows
+// for the next queries up to a limit, so in steady state queries don't touch the global heap.
+class QueryArena {
+public:
+    QueryArena();
+    ~QueryArena();
+
+    QueryArena(const QueryArena&) = delete;
+    QueryArena& operator=(const QueryArena&) = delete;
+
+    // For use by one thread at a time
+    std::pmr::memory_resource* GetResource();
+
+    // The same memory, for containers filled from several threads
+    std::pmr::memory_resource* GetSynchronizedResource();
+
+private:
+    // Counts the bytes the arena had to take beyond the thread buffer
+    class OverflowResource : public std::pmr::memory_resource {
+    public:
+        std::size_t GetOverflowBytes() const;
+
+    private:
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+        void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+        std::size_t overflow_bytes_ = 0;
+    };
+
+    // False if the thread buffer is taken by an enclosing query, e.g. when a parallel algorithm
+    // runs a task of another query on this thread; such an arena works on the heap only
+    bool owns_thread_buffer_ = false;
+    OverflowResource overflow_;
+    std::optional<std::pmr::monotonic_buffer_resource> resource_;
+    std::optional<SynchronizedResource> synchronized_resource_;
+};
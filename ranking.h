@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <map>
+#include <string>
+
+// Corpus-wide statistics that ranking models may depend on
+struct CorpusStats {
+    int document_count = 0;
+    double average_document_length = 0.0;
+};
+
+// Statistics of a corpus split between several servers, summed over all of them.
+// A server scoring with them ranks its documents exactly as one server holding the whole corpus would.
+struct GlobalCorpusStats {
+    int document_count = 0;
+    long long total_document_length = 0;
+    std::map<std::string, int, std::less<>> document_freqs; // of the query terms only
+
+    CorpusStats GetCorpusStats() const {
+        CorpusStats stats;
+        stats.document_count = document_count;
+        if (document_count > 0) {
+            stats.average_document_length = total_document_length * 1.0 / document_count;
+        }
+        return stats;
+    }
+};
+
+// A ranking model is passed to SearchServer::FindTopDocuments as a template
+// parameter, so each model gets its own inlined scoring loop.
+// Every model provides:
+//  - ComputeInverseDocumentFreq(document_count, document_freq) - once per query word
+//  - ComputeTermScore(term_freq, inverse_document_freq, document_length, corpus) - once per posting,
+//    term_freq is the share of the word among the non-stop words of the document
+//  - ComputeRelevance(relevance, rating) - once per matched document
+
+// Classic TF-IDF, the default model
+struct TfIdfRanking {
+    double ComputeInverseDocumentFreq(int document_count, int document_freq) const {
+        return std::log(document_count * 1.0 / document_freq);
+    }
+
+    double ComputeTermScore(double term_freq, double inverse_document_freq, int /*document_length*/, const CorpusStats& /*corpus*/) const {
+        return term_freq * inverse_document_freq;
+    }
+
+    double ComputeRelevance(double relevance, int /*rating*/) const {
+        return relevance;
+    }
+};
+
+// Okapi BM25 with term frequency saturation (k1) and document length normalization (b)
+struct Bm25Ranking {
+    double k1 = 1.2;
+    double b = 0.75;
+
+    double ComputeInverseDocumentFreq(int document_count, int document_freq) const {
+        return std::log((document_count - document_freq + 0.5) / (document_freq + 0.5) + 1.0);
+    }
+
+    double ComputeTermScore(double term_freq, double inverse_document_freq, int document_length, const CorpusStats& corpus) const {
+        // term_freq is normalized by the document length, BM25 needs the raw count
+        const double count = term_freq * document_length;
+        const double length_ratio = corpus.average_document_length > 0
+            ? document_length / corpus.average_document_length
+            : 1.0;
+        return inverse_document_freq * count * (k1 + 1.0) / (count + k1 * (1.0 - b + b * length_ratio));
+    }
+
+    double ComputeRelevance(double relevance, int /*rating*/) const {
+        return relevance;
+    }
+};
+
+// Wraps any model and scales its relevance by the document rating
+template <typename BaseRanking>
+struct RatingBoostedRanking {
+    BaseRanking base;
+    double rating_weight = 0.1;
+
+    double ComputeInverseDocumentFreq(int document_count, int document_freq) const {
+        return base.ComputeInverseDocumentFreq(document_count, document_freq);
+    }
+
+    double ComputeTermScore(double term_freq, double inverse_document_freq, int document_length, const CorpusStats& corpus) const {
+        return base.ComputeTermScore(term_freq, inverse_document_freq, document_length, corpus);
+    }
+
+    double ComputeRelevance(double relevance, int rating) const {
+        return base.ComputeRelevance(relevance, rating) * std::max(0.0, 1.0 + rating_weight * rating);
+    }
+};
@@ -1,33 +1,109 @@
 #include "request_queue.h"
 
-RequestQueue::RequestQueue(const SearchServer& search_server) : search_server_(search_server) {
+#include <algorithm>
+
+RequestQueue::RequestQueue(const SearchServer& search_server, std::chrono::minutes window, std::function<Clock::time_point()> now)
+    : search_server_(search_server)
+    , now_(std::move(now))
+    , start_time_(now_())
+    , window_minutes_(std::max(1, static_cast<int>(window.count())))
+    , buckets_(std::make_unique<MinuteBucket[]>(window_minutes_)) {
 }
 
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentStatus status) {
-    return AddResultRequest(search_server_.FindTopDocuments(raw_query, status));
+    return AddFindRequest(std::execution::seq, raw_query, status);
 }
 
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query) {
-    return AddResultRequest(search_server_.FindTopDocuments(raw_query));
+    return AddFindRequest(std::execution::seq, raw_query);
 }
 
 int RequestQueue::GetNoResultRequests() const {
-    return num_no_result_;
+    return static_cast<int>(GetStats().no_result_requests);
+}
+
+RequestStats RequestQueue::GetStats() const {
+    return GetStats(std::chrono::minutes(window_minutes_));
 }
 
-std::vector<Document> RequestQueue::AddResultRequest(std::vector<Document> doc) {
-    bool no_result = false;
-    if (doc.empty()) {
-        no_result = true;
-        ++num_no_result_;
+RequestStats RequestQueue::GetStats(std::chrono::minutes window) const {
+    const double elapsed_seconds = std::chrono::duration<double>(now_() - start_time_).count();
+    const auto current_minute = static_cast<std::int64_t>(elapsed_seconds / 60.0);
+    const std::int64_t window_minutes = std::clamp<std::int64_t>(window.count(), 1, window_minutes_);
+
+    RequestStats stats;
+    std::uint64_t latencies[LATENCY_BUCKET_COUNT] = {};
+    for (int i = 0; i < window_minutes_; ++i) {
+        const MinuteBucket& bucket = buckets_[i];
+        const std::int64_t minute = bucket.minute.load(std::memory_order_acquire);
+        if (minute < 0 || minute > current_minute || minute <= current_minute - window_minutes) {
+            continue;
+        }
+        stats.requests += bucket.requests.load(std::memory_order_relaxed);
+        stats.no_result_requests += bucket.no_result_requests.load(std::memory_order_relaxed);
+        for (int j = 0; j < LATENCY_BUCKET_COUNT; ++j) {
+            latencies[j] += bucket.latencies[j].load(std::memory_order_relaxed);
+        }
+    }
+    if (stats.requests == 0) {
+        return stats;
+    }
+
+    stats.no_result_rate = stats.no_result_requests * 1.0 / stats.requests;
+
+    // The newest bucket is the current minute, which has only partly passed, and a young queue has not seen the whole window yet
+    const double covered_seconds = (window_minutes - 1) * 60.0 + (elapsed_seconds - current_minute * 60.0);
+    const double window_seconds = std::max(1.0, std::min(elapsed_seconds, covered_seconds));
+    stats.queries_per_second = stats.requests / window_seconds;
+
+    std::uint64_t latency_count = 0;
+    for (const std::uint64_t count : latencies) {
+        latency_count += count;
+    }
+    const auto percentile = [&latencies, latency_count](double p) -> std::uint64_t {
+        const auto rank = static_cast<std::uint64_t>(p * (latency_count - 1));
+        std::uint64_t seen = 0;
+        for (int j = 0; j < LATENCY_BUCKET_COUNT; ++j) {
+            seen += latencies[j];
+            if (seen > rank) {
+                return LatencyBuckets::GetLowerBound(j << LATENCY_BUCKET_SHIFT);
+            }
+        }
+        return 0;
+    };
+    if (latency_count > 0) {
+        stats.latency_p50_ns = percentile(0.5);
+        stats.latency_p90_ns = percentile(0.9);
+        stats.latency_p99_ns = percentile(0.99);
     }
+    return stats;
+}
+
+std::int64_t RequestQueue::GetCurrentMinute() const {
+    return std::chrono::duration_cast<std::chrono::minutes>(now_() - start_time_).count();
+}
 
-    if (requests_.size() == sec_in_day_) {
-        if (requests_.front().no_result) {
-            --num_no_result_;
+RequestQueue::MinuteBucket& RequestQueue::GetBucket(std::int64_t minute) {
+    MinuteBucket& bucket = buckets_[minute % window_minutes_];
+    std::int64_t bucket_minute = bucket.minute.load(std::memory_order_acquire);
+    // The thread that moves the bucket to the new minute clears it. Requests added by other threads
+    // between the move and the clearing are lost, which only happens at a minute boundary.
+    if (bucket_minute < minute && bucket.minute.compare_exchange_strong(bucket_minute, minute, std::memory_order_acq_rel)) {
+        bucket.requests.store(0, std::memory_order_relaxed);
+        bucket.no_result_requests.store(0, std::memory_order_relaxed);
+        for (auto& latency : bucket.latencies) {
+            latency.store(0, std::memory_order_relaxed);
         }
-        requests_.pop_front();
     }
-    requests_.push_back({ no_result });
-    return doc;
-}
\ No newline at end of file
+    return bucket;
+}
+
+std::vector<Document> RequestQueue::AddResultRequest(std::vector<Document> documents, std::uint64_t latency_ns) {
+    MinuteBucket& bucket = GetBucket(GetCurrentMinute());
+    bucket.requests.fetch_add(1, std::memory_order_relaxed);
+    if (documents.empty()) {
+        bucket.no_result_requests.fetch_add(1, std::memory_order_relaxed);
+    }
+    bucket.latencies[LatencyBuckets::GetIndex(latency_ns) >> LATENCY_BUCKET_SHIFT].fetch_add(1, std::memory_order_relaxed);
+    return documents;
+}
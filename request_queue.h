@@ -1,25 +1,89 @@
 #pragma once
-#include <deque>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include "search_server.h"
+#include "metrics.h"
 
+struct RequestStats {
+    std::uint64_t requests = 0;
+    std::uint64_t no_result_requests = 0;
+    double no_result_rate = 0.0;
+    double queries_per_second = 0.0;
+    std::uint64_t latency_p50_ns = 0;
+    std::uint64_t latency_p90_ns = 0;
+    std::uint64_t latency_p99_ns = 0;
+};
+
+// Front-end of a SearchServer that keeps statistics of the requests over a sliding time window.
+// The window is a ring of per-minute buckets updated with atomics only,
+// so any number of threads may add requests and read the statistics at the same time.
 class RequestQueue {
 public:
-    explicit RequestQueue(const SearchServer& search_server);
+    using Clock = std::chrono::steady_clock;
+
+    explicit RequestQueue(const SearchServer& search_server, std::chrono::minutes window = std::chrono::minutes(MINUTES_IN_DAY),
+        std::function<Clock::time_point()> now = Clock::now);
+
     template <typename DocumentPredicate>
     std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate) {
-        return AddResultRequest(search_server_.FindTopDocuments(raw_query, document_predicate));
+        return AddFindRequest(std::execution::seq, raw_query, document_predicate);
     }
     std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentStatus status);
     std::vector<Document> AddFindRequest(const std::string& raw_query);
+
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> AddFindRequest(ExecutionPolicy policy, const std::string& raw_query, DocumentPredicate document_predicate) {
+        const std::uint64_t start_ns = GetNowNs();
+        auto documents = search_server_.FindTopDocuments(policy, raw_query, document_predicate);
+        return AddResultRequest(std::move(documents), GetNowNs() - start_ns);
+    }
+
+    template <typename ExecutionPolicy>
+    std::vector<Document> AddFindRequest(ExecutionPolicy policy, const std::string& raw_query, DocumentStatus status) {
+        return AddFindRequest(policy, raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
+            return document_status == status;
+            });
+    }
+
+    template <typename ExecutionPolicy>
+    std::vector<Document> AddFindRequest(ExecutionPolicy policy, const std::string& raw_query) {
+        return AddFindRequest(policy, raw_query, DocumentStatus::ACTUAL);
+    }
+
+    // Number of requests without results over the whole window
     int GetNoResultRequests() const;
+
+    RequestStats GetStats() const;
+
+    // Statistics over the last minutes of the window, at most the whole window
+    RequestStats GetStats(std::chrono::minutes window) const;
+
 private:
-    struct QueryResult {
-        bool no_result = false;
+    static const int MINUTES_IN_DAY = 1440;
+    // Latencies are kept with 4 buckets per power of two (~19% precision) to keep a day of buckets small
+    static const int LATENCY_BUCKET_SHIFT = 2;
+    static const int LATENCY_BUCKET_COUNT = (LatencyBuckets::BUCKET_COUNT >> LATENCY_BUCKET_SHIFT) + 1;
+
+    struct MinuteBucket {
+        std::atomic<std::int64_t> minute{ -1 };
+        std::atomic<std::uint64_t> requests{ 0 };
+        std::atomic<std::uint64_t> no_result_requests{ 0 };
+        std::atomic<std::uint64_t> latencies[LATENCY_BUCKET_COUNT] = {};
     };
-    std::deque<QueryResult> requests_;
-    const static int sec_in_day_ = 1440;
+
     const SearchServer& search_server_;
-    int num_no_result_ = 0;
-    std::vector<Document> AddResultRequest(std::vector<Document> doc);
+    const std::function<Clock::time_point()> now_;
+    const Clock::time_point start_time_;
+    const int window_minutes_;
+    std::unique_ptr<MinuteBucket[]> buckets_;
+
+    std::int64_t GetCurrentMinute() const;
+
+    // Returns the bucket of the minute, recycling it if it still holds an older minute
+    MinuteBucket& GetBucket(std::int64_t minute);
 
-};
\ No newline at end of file
+    std::vector<Document> AddResultRequest(std::vector<Document> documents, std::uint64_t latency_ns);
+};
@@ -1,31 +1,62 @@
 #include "search_server.h"
 #include "string_processing.h"
 
-SearchServer::SearchServer(const std::string& stop_words_text)
-    : SearchServer(SplitIntoWords(stop_words_text))  // Invoke delegating constructor
-                                                     // from string container
+#include <charconv>
+#include <cmath>
+
+SearchServer::SearchServer(const std::string& stop_words_text, IndexOptions options)
+    : SearchServer(SplitIntoWords(stop_words_text), options)  // Invoke delegating constructor
+                                                              // from string container
 {
 }
 
-SearchServer::SearchServer(std::string_view stop_words_text)
-    : SearchServer(SplitIntoWords(std::string(stop_words_text)))
+SearchServer::SearchServer(std::string_view stop_words_text, IndexOptions options)
+    : SearchServer(SplitIntoWords(std::string(stop_words_text)), options)
 {
 }
 
 void SearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
+    AddDocument(document_id, TokenizeDocument(document), status, ratings);
+}
+
+SearchServer::TokenizedDocument SearchServer::TokenizeDocument(std::string_view document) const {
+    TokenizedDocument result;
+    result.words = SplitIntoWordsNoStop(document, options_.store_positions ? &result.positions : nullptr);
+    return result;
+}
+
+void SearchServer::AddDocument(int document_id, const TokenizedDocument& document, DocumentStatus status, const std::vector<int>& ratings) {
+    OperationTimer timer(MetricOperation::ADD_DOCUMENT);
     if ((document_id < 0) || (documents_.count(document_id) > 0)) {
         throw std::invalid_argument("Document id: ["s + std::to_string(document_id) + "] is invalid"s);
     }
-    const auto words = SplitIntoWordsNoStop(document);
+    if (!IsValidDocumentStatus(status)) {
+        throw std::invalid_argument("Document status: ["s + std::to_string(static_cast<int>(status)) + "] is invalid"s);
+    }
+    if (options_.store_positions && document.positions.size() != document.words.size()) {
+        throw std::invalid_argument("Document ["s + std::to_string(document_id) + "] is tokenized without positions"s);
+    }
+    const auto& words = document.words;
+    const auto& positions = document.positions;
 
     const double inv_word_count = 1.0 / words.size();
-    for (const std::string& word : words) {
-        const auto [it,_] = source_words_.emplace(word);
+    for (std::size_t i = 0; i < words.size(); ++i) {
+        const auto [it,_] = source_words_.emplace(words[i]);
         word_to_document_freqs_[*it][document_id] += inv_word_count;
         documents_to_word_freqs_[document_id][*it] += inv_word_count;
+        if (options_.store_positions) {
+            documents_to_word_positions_[document_id][*it].Add(positions[i]);
+        }
     }
     document_ids_.insert(document_id);
-    documents_.emplace(document_id, DocumentData{ ComputeAverageRating(ratings), status });
+    const int rating = ComputeAverageRating(ratings);
+    documents_.try_emplace(document_id, rating, status, static_cast<int>(words.size()));
+    total_document_length_ += words.size();
+
+    std::unique_lock guard(metadata_mutex_);
+    all_documents_.Set(document_id);
+    status_documents_[static_cast<int>(status)].Set(document_id);
+    rating_documents_.emplace(rating, document_id);
 }
 
 std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status) const {
@@ -36,29 +67,148 @@ std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query)
     return FindTopDocuments(std::execution::seq, raw_query);
 }
 
+long long SearchServer::GetRelevanceKey(double relevance) {
+    return std::llround(relevance * RELEVANCE_KEY_SCALE);
+}
+
+bool SearchServer::IsBetterDocument(const Document& lhs, const Document& rhs) {
+    // Relevances closer than the key step are tied, yet the keys keep the order a strict weak ordering
+    const long long lhs_key = GetRelevanceKey(lhs.relevance);
+    const long long rhs_key = GetRelevanceKey(rhs.relevance);
+    if (lhs_key != rhs_key) {
+        return lhs_key > rhs_key;
+    }
+    if (lhs.rating != rhs.rating) {
+        return lhs.rating > rhs.rating;
+    }
+    return lhs.id < rhs.id;
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, const DocumentFilter& filter) const {
+    return FindTopDocuments(std::execution::seq, raw_query, filter);
+}
+
+GlobalCorpusStats SearchServer::GetQueryCorpusStats(std::string_view raw_query) const {
+    QueryArena arena;
+    const auto query = ParseQuery(raw_query, arena.GetResource());
+    GlobalCorpusStats stats;
+    stats.document_count = GetDocumentCount();
+    stats.total_document_length = total_document_length_;
+    for (std::string_view word : query.plus_words) {
+        if (const auto it = word_to_document_freqs_.find(word); it != word_to_document_freqs_.end() && !it->second.empty()) {
+            stats.document_freqs.emplace(word, static_cast<int>(it->second.size()));
+        }
+    }
+    return stats;
+}
+
+int SearchServer::GetDocumentFreq(std::string_view word, const PostingList& postings, const GlobalCorpusStats* global_stats) {
+    if (global_stats) {
+        if (const auto it = global_stats->document_freqs.find(word); it != global_stats->document_freqs.end()) {
+            return it->second;
+        }
+    }
+    return static_cast<int>(postings.size());
+}
+
 int SearchServer::GetDocumentCount() const {
     return static_cast<int>(documents_.size());
 }
 
-std::set<int>::const_iterator SearchServer::begin() const {//O(1)
+CorpusStats SearchServer::GetCorpusStats() const {
+    CorpusStats stats;
+    stats.document_count = GetDocumentCount();
+    if (stats.document_count > 0) {
+        stats.average_document_length = total_document_length_ * 1.0 / stats.document_count;
+    }
+    return stats;
+}
+
+std::pmr::set<int>::const_iterator SearchServer::begin() const {//O(1)
     return document_ids_.begin();
 }
 
-std::set<int>::const_iterator SearchServer::end() const {//O(1)
+std::pmr::set<int>::const_iterator SearchServer::end() const {//O(1)
     return document_ids_.end();
 }
 
-const std::map<std::string_view, double>& SearchServer::GetWordFrequencies(int document_id) const {
+const SearchServer::WordFrequencies& SearchServer::GetWordFrequencies(int document_id) const {
     const auto it = documents_to_word_freqs_.find(document_id);//O(N)
     if (it != documents_to_word_freqs_.end()) {
         return it->second;
     }
     else {
-        static const std::map<std::string_view, double> dummy;
+        static const WordFrequencies dummy;
         return dummy;
     }
 }
 
+std::size_t IndexMemoryUsage::GetTotal() const {
+    return word_to_document_freqs + documents_to_word_freqs + source_words + documents
+        + word_positions + document_ids + filter_indexes;
+}
+
+IndexMemoryUsage SearchServer::GetMemoryUsage() const {
+    IndexMemoryUsage usage;
+    usage.word_to_document_freqs = word_to_document_freqs_resource_.GetAllocatedBytes();
+    usage.documents_to_word_freqs = documents_to_word_freqs_resource_.GetAllocatedBytes();
+    usage.source_words = source_words_resource_.GetAllocatedBytes();
+    usage.documents = documents_resource_.GetAllocatedBytes();
+    usage.word_positions = word_positions_resource_.GetAllocatedBytes();
+    usage.document_ids = document_ids_resource_.GetAllocatedBytes();
+    usage.filter_indexes = filter_indexes_resource_.GetAllocatedBytes();
+    return usage;
+}
+
+IndexStats SearchServer::GetIndexStats(std::size_t top_term_count) const {
+    IndexStats stats;
+    stats.memory = GetMemoryUsage();
+    stats.document_count = documents_.size();
+
+    // Min-heap of the heaviest terms seen so far: the lightest one is replaced first
+    using HeavyTerm = std::pair<std::size_t, std::string_view>;
+    const auto is_heavier = [](const HeavyTerm& lhs, const HeavyTerm& rhs) {
+        return lhs.first > rhs.first || (lhs.first == rhs.first && lhs.second < rhs.second);
+    };
+    std::vector<HeavyTerm> heaviest_terms;
+    heaviest_terms.reserve(top_term_count + 1);
+
+    for (const auto& [term, postings] : word_to_document_freqs_) {
+        const std::size_t posting_count = postings.size();
+        if (posting_count == 0) {
+            continue;
+        }
+        ++stats.term_count;
+        stats.posting_count += posting_count;
+
+        std::size_t bucket = 0;
+        while ((posting_count >> (bucket + 1)) > 0) {
+            ++bucket;
+        }
+        if (stats.posting_length_histogram.size() <= bucket) {
+            stats.posting_length_histogram.resize(bucket + 1);
+        }
+        ++stats.posting_length_histogram[bucket];
+
+        if (top_term_count == 0) {
+            continue;
+        }
+        heaviest_terms.emplace_back(posting_count, term);
+        std::push_heap(heaviest_terms.begin(), heaviest_terms.end(), is_heavier);
+        if (heaviest_terms.size() > top_term_count) {
+            std::pop_heap(heaviest_terms.begin(), heaviest_terms.end(), is_heavier);
+            heaviest_terms.pop_back();
+        }
+    }
+
+    std::sort_heap(heaviest_terms.begin(), heaviest_terms.end(), is_heavier);
+    stats.heaviest_terms.reserve(heaviest_terms.size());
+    for (const auto& [posting_count, term] : heaviest_terms) {
+        stats.heaviest_terms.push_back({ std::string(term), posting_count });
+    }
+    return stats;
+}
+
 void SearchServer::RemoveDocument( int document_id) {
     RemoveDocument(std::execution::seq, document_id);
 }
@@ -67,8 +217,54 @@ std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDoc
     return MatchDocument(std::execution::seq, raw_query, document_id);
 }
 
+void SearchServer::SetDocumentStatus(int document_id, DocumentStatus status) {
+    SetDocumentStatus(std::vector<int>{ document_id }, status);
+}
+
+void SearchServer::SetDocumentStatus(const std::vector<int>& document_ids, DocumentStatus status) {
+    if (!IsValidDocumentStatus(status)) {
+        throw std::invalid_argument("Document status: ["s + std::to_string(static_cast<int>(status)) + "] is invalid"s);
+    }
+    std::vector<DocumentData*> documents = GetDocumentsForUpdate(document_ids);
+
+    std::unique_lock guard(metadata_mutex_);
+    for (std::size_t i = 0; i < documents.size(); ++i) {
+        const DocumentStatus old_status = documents[i]->status.exchange(status);
+        status_documents_[static_cast<int>(old_status)].Reset(document_ids[i]);
+        status_documents_[static_cast<int>(status)].Set(document_ids[i]);
+    }
+}
+
+void SearchServer::SetDocumentRating(int document_id, int rating) {
+    SetDocumentRating(std::vector<int>{ document_id }, rating);
+}
+
+void SearchServer::SetDocumentRating(const std::vector<int>& document_ids, int rating) {
+    std::vector<DocumentData*> documents = GetDocumentsForUpdate(document_ids);
+
+    std::unique_lock guard(metadata_mutex_);
+    for (std::size_t i = 0; i < documents.size(); ++i) {
+        const int old_rating = documents[i]->rating.exchange(rating);
+        rating_documents_.erase({ old_rating, document_ids[i] });
+        rating_documents_.emplace(rating, document_ids[i]);
+    }
+}
+
+std::vector<SearchServer::DocumentData*> SearchServer::GetDocumentsForUpdate(const std::vector<int>& document_ids) {
+    std::vector<DocumentData*> documents;
+    documents.reserve(document_ids.size());
+    for (const int document_id : document_ids) {
+        const auto it = documents_.find(document_id);
+        if (it == documents_.end()) {
+            throw std::invalid_argument("Document id: ["s + std::to_string(document_id) + "] is invalid"s);
+        }
+        documents.push_back(&it->second);
+    }
+    return documents;
+}
+
 bool SearchServer::IsStopWord(std::string_view word) const {
-    return stop_words_.count(word) > 0;
+    return stop_words_.Contains(word);
 }
 
 bool SearchServer::IsValidWord(std::string_view word) {
@@ -80,15 +276,20 @@ bool SearchServer::IsValidWord(std::string_view word) {
     );
 }
 
-std::vector<std::string> SearchServer::SplitIntoWordsNoStop(std::string_view text) const {
-    std::vector<std::string> words;
+std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(std::string_view text, std::vector<int>* positions) const {
+    std::vector<std::string_view> words;
+    int position = 0;
     for (std::string_view word : SplitIntoWords(text)) {
         if (!IsValidWord(word)) {
             throw std::invalid_argument("Word from document ["s + std::string(word) + "] is invalid"s);
         }
         if (!IsStopWord(word)) {
-            words.push_back(std::string(word));
+            words.push_back(word);
+            if (positions) {
+                positions->push_back(position);
+            }
         }
+        ++position;
     }
     return words;
 }
@@ -109,38 +310,232 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view text) cons
         throw std::invalid_argument("Query word is empty"s);
     }
     bool is_minus = false;
+    bool is_required = false;
     if (text[0] == '-') {
         is_minus = true;
         text = text.substr(1);
     }
-    if (text.empty() || text[0] == '-' || !IsValidWord(text)) {
+    else if (text[0] == '+') {
+        is_required = true;
+        text = text.substr(1);
+    }
+    bool is_prefix = false;
+    int max_edits = 0;
+    if (!text.empty() && text.back() == '*') {
+        is_prefix = true;
+        text.remove_suffix(1);
+    }
+    else if (const auto tilde_pos = text.find('~'); tilde_pos != std::string_view::npos) {
+        const std::string_view edits = text.substr(tilde_pos + 1);
+        if (edits.empty()) {
+            max_edits = 1;
+        }
+        else if (edits.size() == 1 && edits[0] >= '1' && edits[0] <= '0' + MAX_QUERY_EDIT_DISTANCE) {
+            max_edits = edits[0] - '0';
+        }
+        else {
+            throw std::invalid_argument("Edit distance of query word ["s + std::string(text) + "] is invalid"s);
+        }
+        text = text.substr(0, tilde_pos);
+    }
+    if (text.empty() || text[0] == '-' || text[0] == '+' || !IsValidWord(text)) {
         throw std::invalid_argument("Query word ["s + std::string(text) + "] is invalid");
     }
+    if (is_required && (is_prefix || max_edits > 0)) {
+        throw std::invalid_argument("Required query word ["s + std::string(text) + "] can't be expanded"s);
+    }
 
-    return { text, is_minus, IsStopWord(text) };
+    return { text, is_minus, IsStopWord(text), is_required, is_prefix, max_edits };
 }
 
 
-SearchServer::Query SearchServer::ParseQuery(std::string_view text) const {
-    Query result;
-    std::set<std::string_view> minus_words;
-    
-    for (std::string_view word : SplitIntoWords(text)) {
+SearchServer::Query SearchServer::ParseQuery(std::string_view text, std::pmr::memory_resource* resource) const {
+    Query result(resource);
+    std::pmr::set<std::string_view> minus_words(resource);
+    std::pmr::set<std::string_view> required_words(resource);
+
+    const auto words = SplitIntoWords(text, resource);
+    for (std::size_t i = 0; i < words.size(); ++i) {
+        std::string_view word = words[i];
+        if (!word.empty() && word[0] == '"') {
+            i = ParsePhrase(words, i, result);
+            continue;
+        }
         const auto query_word = ParseQueryWord(word);
-        if (!query_word.is_stop) {
+        // Stop words are never indexed, but they still may be a prefix of or a typo in an indexed word
+        if (!query_word.is_stop || query_word.is_prefix || query_word.max_edits > 0) {
             if (query_word.is_minus) {
-                minus_words.insert(query_word.data);
+                AddQueryWord(query_word, minus_words);
             }
             else {
-                result.plus_words.insert(query_word.data);
+                AddQueryWord(query_word, result.plus_words);
+                if (query_word.is_required) {
+                    required_words.insert(query_word.data);
+                }
             }
         }
     }
-    result.minus_words = std::vector<std::string_view>(minus_words.begin(), minus_words.end());
+    // A document without one of the phrase words can't match the phrase
+    for (const Phrase& phrase : result.phrases) {
+        required_words.insert(phrase.words.begin(), phrase.words.end());
+    }
+    result.minus_words.assign(minus_words.begin(), minus_words.end());
+    result.required_words.assign(required_words.begin(), required_words.end());
     return result;
 }
 
-// Existence required
-double SearchServer::ComputeWordInverseDocumentFreq(std::string_view word) const {
-    return std::log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+std::size_t SearchServer::ParsePhrase(const std::pmr::vector<std::string_view>& words, std::size_t index, Query& query) const {
+    if (!options_.store_positions) {
+        throw std::invalid_argument("Phrase queries require an index with stored positions"s);
+    }
+
+    Phrase phrase(query.phrases.get_allocator());
+    int offset = 0;
+    for (std::size_t i = index; i < words.size(); ++i, ++offset) {
+        std::string_view word = words[i];
+        if (i == index) {
+            word.remove_prefix(1);
+        }
+
+        const auto quote_pos = word.find('"');
+        std::string_view suffix;
+        if (quote_pos != std::string_view::npos) {
+            suffix = word.substr(quote_pos + 1);
+            word = word.substr(0, quote_pos);
+        }
+
+        if (!word.empty()) {
+            const auto query_word = ParseQueryWord(word);
+            if (query_word.is_minus || query_word.is_required || query_word.is_prefix || query_word.max_edits > 0) {
+                throw std::invalid_argument("Phrase word ["s + std::string(word) + "] must be a plain word"s);
+            }
+            if (!query_word.is_stop) {
+                phrase.words.push_back(query_word.data);
+                phrase.offsets.push_back(offset);
+                query.plus_words.insert(query_word.data);
+            }
+        }
+
+        if (quote_pos == std::string_view::npos) {
+            continue;
+        }
+
+        // Closing quote, optionally followed by ~N
+        if (!suffix.empty()) {
+            if (suffix[0] != '~' || suffix.size() == 1
+                || !std::all_of(suffix.begin() + 1, suffix.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+                throw std::invalid_argument("Phrase suffix ["s + std::string(suffix) + "] is invalid"s);
+            }
+            const auto [end, error] = std::from_chars(suffix.data() + 1, suffix.data() + suffix.size(), phrase.slop);
+            if (error != std::errc() || phrase.slop > MAX_PHRASE_SLOP) {
+                throw std::invalid_argument("Phrase slop ["s + std::string(suffix.substr(1)) + "] is out of range"s);
+            }
+        }
+        // A single word matches trivially, it only needs to be a plus word
+        if (phrase.words.size() > 1) {
+            query.phrases.push_back(std::move(phrase));
+        }
+        return i;
+    }
+    throw std::invalid_argument("Phrase is not closed"s);
+}
+
+bool SearchServer::MatchesPhrases(const Query& query, int document_id, PhrasePositions& positions, int* match_counts) const {
+    if (query.phrases.empty()) {
+        return true;
+    }
+
+    const auto document_it = documents_to_word_positions_.find(document_id);
+    if (document_it == documents_to_word_positions_.end()) {
+        return false;
+    }
+    const auto& word_positions = document_it->second;
+
+    for (std::size_t i = 0; i < query.phrases.size(); ++i) {
+        const Phrase& phrase = query.phrases[i];
+        // The inner vectors keep their memory for the next documents
+        if (positions.size() < phrase.words.size()) {
+            positions.resize(phrase.words.size());
+        }
+        for (std::size_t j = 0; j < phrase.words.size(); ++j) {
+            const auto it = word_positions.find(phrase.words[j]);
+            if (it == word_positions.end()) {
+                return false;
+            }
+            it->second.Decode(positions[j]);
+        }
+        if (match_counts) {
+            match_counts[i] = CountPhraseMatches(positions, phrase.offsets, phrase.slop);
+            if (match_counts[i] == 0) {
+                return false;
+            }
+        }
+        else if (!HasPhraseMatch(positions, phrase.offsets, phrase.slop)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+DocumentBitmap SearchServer::EvaluateFilter(const DocumentFilter& filter, std::pmr::memory_resource* resource) const {
+    std::shared_lock guard(metadata_mutex_);
+    return EvaluateFilterLocked(filter, resource);
+}
+
+DocumentBitmap SearchServer::EvaluateFilterLocked(const DocumentFilter& filter, std::pmr::memory_resource* resource) const {
+    switch (filter.GetKind()) {
+    case DocumentFilter::Kind::ANY:
+        return DocumentBitmap(all_documents_, resource);
+    case DocumentFilter::Kind::STATUS: {
+        DocumentBitmap result(resource);
+        for (int status = 0; status < DOCUMENT_STATUS_COUNT; ++status) {
+            if (filter.HasStatus(static_cast<DocumentStatus>(status))) {
+                result |= status_documents_[status];
+            }
+        }
+        return result;
+    }
+    case DocumentFilter::Kind::RATING_RANGE: {
+        // lower_bound of an inverted range lies past its upper_bound
+        if (filter.GetMin() > filter.GetMax()) {
+            return DocumentBitmap(resource);
+        }
+        // The index is ordered by rating, the bitmap is filled fastest in the order of ids
+        std::pmr::vector<int> document_ids(resource);
+        const auto last = rating_documents_.upper_bound({ filter.GetMax(), INT_MAX });
+        for (auto it = rating_documents_.lower_bound({ filter.GetMin(), INT_MIN }); it != last; ++it) {
+            document_ids.push_back(it->second);
+        }
+        std::sort(document_ids.begin(), document_ids.end());
+        DocumentBitmap result(resource);
+        for (const int document_id : document_ids) {
+            result.Set(document_id);
+        }
+        return result;
+    }
+    case DocumentFilter::Kind::ID_RANGE: {
+        DocumentBitmap result(all_documents_, resource);
+        result.KeepRange(filter.GetMin(), filter.GetMax());
+        return result;
+    }
+    case DocumentFilter::Kind::AND: {
+        const auto& children = filter.GetChildren();
+        if (children.empty()) {
+            return DocumentBitmap(all_documents_, resource);
+        }
+        DocumentBitmap result = EvaluateFilterLocked(children.front(), resource);
+        for (auto it = std::next(children.begin()); it != children.end(); ++it) {
+            result &= EvaluateFilterLocked(*it, resource);
+        }
+        return result;
+    }
+    case DocumentFilter::Kind::OR: {
+        DocumentBitmap result(resource);
+        for (const DocumentFilter& child : filter.GetChildren()) {
+            result |= EvaluateFilterLocked(child, resource);
+        }
+        return result;
+    }
+    }
+    return DocumentBitmap(resource);
 }
@@ -1,5 +1,10 @@
 #pragma once
+#include <array>
+#include <atomic>
 #include <map>
+#include <memory_resource>
+#include <mutex>
+#include <shared_mutex>
 #include <set>
 #include <stdexcept>
 #include <string>
@@ -15,14 +20,68 @@
 #include "string_processing.h"
 #include "concurrent_map.h"
 #include "log_duration.h"
+#include "ranking.h"
+#include "positions.h"
+#include "term_dictionary.h"
+#include "stop_words.h"
+#include "metrics.h"
+#include "posting_lists.h"
+#include "document_bitmap.h"
+#include "document_filter.h"
+#include "query_arena.h"
+#include "counting_resource.h"
 
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
+const int MAX_QUERY_EDIT_DISTANCE = 2;
+const int MAX_PHRASE_SLOP = 1'000'000;
+
+struct ResultPage {
+    std::vector<Document> documents;
+    std::string next_cursor;         // empty on the last page
+    std::size_t total_documents = 0; // matched documents of the whole query
+};
+
+// Bytes held by the structures of a SearchServer, as counted by their allocators
+struct IndexMemoryUsage {
+    std::size_t word_to_document_freqs = 0;  // posting lists
+    std::size_t documents_to_word_freqs = 0; // words of every document
+    std::size_t source_words = 0;            // texts of the terms
+    std::size_t documents = 0;               // rating, status and length of every document
+    std::size_t word_positions = 0;          // positions of the words of every document, if stored
+    std::size_t document_ids = 0;
+    std::size_t filter_indexes = 0;          // status, rating and id indexes for DocumentFilter
+
+    std::size_t GetTotal() const;
+};
+
+struct TermPostingCount {
+    std::string term;
+    std::size_t posting_count = 0;
+};
+
+struct IndexStats {
+    IndexMemoryUsage memory;
+    std::size_t document_count = 0;
+    std::size_t term_count = 0;    // terms present in at least one document
+    std::size_t posting_count = 0;
+    // posting_length_histogram[i] is the number of terms with [2^i, 2^(i+1)) postings
+    std::vector<std::size_t> posting_length_histogram;
+    // The longest posting lists, longest first. Postings are equal-sized map nodes,
+    // so these are also the terms taking the most memory
+    std::vector<TermPostingCount> heaviest_terms;
+};
+
+struct IndexOptions {
+    // Keep word positions of every document. Required for "phrase" and "proximity"~N queries
+    bool store_positions = false;
+};
 
 class SearchServer {
 public:
     template <typename StringContainer>
-    explicit SearchServer(const StringContainer& stop_words)
+    explicit SearchServer(const StringContainer& stop_words, IndexOptions options = {})
         : stop_words_(MakeUniqueNonEmptyStrings(stop_words))  // Extract non-empty stop words
+        , options_(options)
     {
         if (!std::all_of(stop_words_.begin(), stop_words_.end(), IsValidWord)) {
             using namespace std::string_literals;
@@ -30,11 +89,23 @@ public:
         }
     }
 
-    explicit SearchServer(const std::string& stop_words_text);
-    explicit SearchServer(std::string_view stop_words_text);
+    explicit SearchServer(const std::string& stop_words_text, IndexOptions options = {});
+    explicit SearchServer(std::string_view stop_words_text, IndexOptions options = {});
 
     void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
 
+    // Document text split into the words to index, see TokenizeDocument
+    struct TokenizedDocument {
+        std::vector<std::string_view> words; // non-stop words, point into the text
+        std::vector<int> positions;          // position of every word in the text, only if positions are stored
+    };
+
+    // Only reads the stop words and the options, so it may run on several threads,
+    // also while AddDocument runs on another one. The text must outlive the result.
+    TokenizedDocument TokenizeDocument(std::string_view document) const;
+
+    void AddDocument(int document_id, const TokenizedDocument& document, DocumentStatus status, const std::vector<int>& ratings);
+
     template <typename DocumentPredicate>
     std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const {
         return FindTopDocuments(std::execution::seq, raw_query, document_predicate);
@@ -46,26 +117,43 @@ public:
 
     template <typename ExecutionPolicy, typename DocumentPredicate>
     std::vector<Document> FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query, DocumentPredicate document_predicate) const {
-        const auto query = ParseQuery(raw_query);
+        return FindTopDocuments(policy, raw_query, document_predicate, TfIdfRanking{});
+    }
 
-        auto matched_documents = FindAllDocuments(policy, query, document_predicate);
+    // RankingModel is one of the models from ranking.h (TfIdfRanking, Bm25Ranking, RatingBoostedRanking<...>)
+    template <typename ExecutionPolicy, typename DocumentPredicate, typename RankingModel>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query, DocumentPredicate document_predicate,
+        const RankingModel& ranking) const {
+        QueryArena arena;
+        return FindTopDocumentsImpl(policy, raw_query, document_predicate, ranking, nullptr, arena);
+    }
 
-        std::sort(policy, matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs) {
-            if (std::abs(lhs.relevance - rhs.relevance) < 1e-6) {
-                return lhs.rating > rhs.rating;
-            }
-            else {
-                return lhs.relevance > rhs.relevance;
-            }
-            });
+    // Also fills the execution profile of the query
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query, DocumentPredicate document_predicate,
+        QueryStats& stats) const {
+        QueryArena arena;
+        return FindTopDocumentsImpl(policy, raw_query, document_predicate, TfIdfRanking{}, &stats, arena);
+    }
 
-        if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-            matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
-        }
+    template <typename ExecutionPolicy, typename DocumentPredicate, typename RankingModel>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query, DocumentPredicate document_predicate,
+        const RankingModel& ranking, QueryStats& stats) const {
+        QueryArena arena;
+        return FindTopDocumentsImpl(policy, raw_query, document_predicate, ranking, &stats, arena);
+    }
 
-        return matched_documents;
+    // For a corpus split between several servers: scores with the statistics of the whole corpus instead of the local ones
+    template <typename ExecutionPolicy, typename DocumentPredicate, typename RankingModel>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query, DocumentPredicate document_predicate,
+        const RankingModel& ranking, const GlobalCorpusStats& global_stats) const {
+        QueryArena arena;
+        return FindTopDocumentsImpl(policy, raw_query, document_predicate, ranking, nullptr, arena, nullptr, &global_stats);
     }
 
+    // Local part of the GlobalCorpusStats of the query: the statistics of its terms on this server
+    GlobalCorpusStats GetQueryCorpusStats(std::string_view raw_query) const;
+
     template <typename ExecutionPolicy>
     std::vector<Document> FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query, DocumentStatus status) const {
         return FindTopDocuments(policy, raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
@@ -73,16 +161,111 @@ public:
             });
     }
 
+    template <typename ExecutionPolicy, typename RankingModel>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query, DocumentStatus status,
+        const RankingModel& ranking) const {
+        return FindTopDocuments(policy, raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
+            return document_status == status;
+            }, ranking);
+    }
+
     template <typename ExecutionPolicy>
     std::vector<Document> FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query) const {
         return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
     }
 
+    // The filter is pushed down: it is evaluated on the status and rating indexes before the postings are scanned,
+    // and a selective filter also limits which postings are visited
+    template <typename ExecutionPolicy, typename RankingModel>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query, const DocumentFilter& filter,
+        const RankingModel& ranking) const {
+        QueryArena arena;
+        const DocumentBitmap allowed = EvaluateFilter(filter, arena.GetResource());
+        const bool is_selective = allowed.Count() * SELECTIVE_FILTER_RATIO < documents_.size();
+        std::pmr::vector<int> allowed_ids(arena.GetResource());
+        if (is_selective) {
+            allowed_ids = allowed.GetIds(arena.GetResource());
+        }
+        return FindTopDocumentsImpl(policy, raw_query,
+            [&allowed](int document_id, DocumentStatus status, int rating) {
+                return allowed.Test(document_id);
+            },
+            ranking, nullptr, arena, is_selective ? &allowed_ids : nullptr);
+    }
+
+    template <typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query, const DocumentFilter& filter) const {
+        return FindTopDocuments(policy, raw_query, filter, TfIdfRanking{});
+    }
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, const DocumentFilter& filter) const;
+
+    // Deep pagination: the documents at [offset, offset + limit) of the full result order.
+    // Only offset + limit documents get sorted, the rest is just partitioned away.
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    ResultPage FindTopDocumentsPage(ExecutionPolicy policy, std::string_view raw_query, DocumentPredicate document_predicate,
+        std::size_t offset, std::size_t limit) const {
+        OperationTimer timer(MetricOperation::FIND_TOP_DOCUMENTS);
+        QueryArena arena;
+        const auto query = ParseQuery(raw_query, arena.GetResource());
+        auto matched_documents = FindAllDocuments(policy, query, document_predicate, TfIdfRanking{}, nullptr, arena);
+
+        ResultPage page;
+        page.total_documents = matched_documents.size();
+        if (offset >= matched_documents.size()) {
+            return page;
+        }
+        // offset + limit may overflow
+        SelectTopDocuments(policy, matched_documents, offset + std::min(limit, matched_documents.size() - offset));
+        page.documents.assign(matched_documents.begin() + offset, matched_documents.end());
+        if (offset + page.documents.size() < page.total_documents && !page.documents.empty()) {
+            page.next_cursor = EncodeSearchCursor(page.documents.back());
+        }
+        return page;
+    }
+
+    // Cursor pagination: up to limit documents following the cursor of the previous page
+    // (ResultPage::next_cursor), an empty cursor starts from the beginning
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    ResultPage FindTopDocumentsAfter(ExecutionPolicy policy, std::string_view raw_query, DocumentPredicate document_predicate,
+        std::string_view cursor, std::size_t limit) const {
+        OperationTimer timer(MetricOperation::FIND_TOP_DOCUMENTS);
+        QueryArena arena;
+        const auto query = ParseQuery(raw_query, arena.GetResource());
+        auto matched_documents = FindAllDocuments(policy, query, document_predicate, TfIdfRanking{}, nullptr, arena);
+
+        ResultPage page;
+        page.total_documents = matched_documents.size();
+        if (!cursor.empty()) {
+            const Document last = DecodeSearchCursor(cursor);
+            matched_documents.erase(std::remove_if(matched_documents.begin(), matched_documents.end(),
+                [&last](const Document& document) {
+                    return !IsBetterDocument(last, document);
+                }), matched_documents.end());
+        }
+        const bool has_more = matched_documents.size() > limit;
+        SelectTopDocuments(policy, matched_documents, limit);
+        page.documents.assign(matched_documents.begin(), matched_documents.end());
+        if (has_more && !page.documents.empty()) {
+            page.next_cursor = EncodeSearchCursor(page.documents.back());
+        }
+        return page;
+    }
+
+    // Order of the results: by relevance, then by rating, then by id.
+    // Relevances are compared by GetRelevanceKey, so the ones differing by rounding errors are tied
+    static bool IsBetterDocument(const Document& lhs, const Document& rhs);
+
+    // Relevance rounded to 1e-6, the ordering key of IsBetterDocument, cursors and the merge of shards
+    static long long GetRelevanceKey(double relevance);
+
     int GetDocumentCount() const;
 
-    std::set<int>::const_iterator begin() const;
+    CorpusStats GetCorpusStats() const;
+
+    std::pmr::set<int>::const_iterator begin() const;
 
-    std::set<int>::const_iterator end() const;
+    std::pmr::set<int>::const_iterator end() const;
 
     //На вход поступает запрос и id документа
     //Возвращаеться кортедж и в первом элементе все плюс-слова запроса (без дублирования), содержащиеся в документе. 
@@ -95,13 +278,15 @@ public:
             || std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>)) {
             return{};
         }
+        OperationTimer timer(MetricOperation::MATCH_DOCUMENT);
 
         if ((document_id < 0) || (document_ids_.count(document_id) == 0)) {
             throw std::invalid_argument("Document id: ["s + std::to_string(document_id) + "] is invalid"s);
         }
 
-        const auto query = ParseQuery(raw_query);
-        std::vector<std::string_view> word_to_document(documents_to_word_freqs_.at(document_id).size());
+        QueryArena arena;
+        const auto query = ParseQuery(raw_query, arena.GetResource());
+        std::pmr::vector<std::string_view> word_to_document(documents_to_word_freqs_.at(document_id).size(), arena.GetResource());
 
         std::transform(policy,
             documents_to_word_freqs_.at(document_id).begin(),
@@ -109,24 +294,36 @@ public:
             word_to_document.begin(),
             [](auto pair) { return pair.first; });
 
-        std::vector<std::string_view> intersection(std::max(query.minus_words.size(),query.plus_words.size()));
+        std::pmr::vector<std::string_view> intersection(std::max(query.minus_words.size(), query.plus_words.size()), arena.GetResource());
         auto it_begin = intersection.begin();
         auto it_end = std::set_intersection(policy, word_to_document.begin(), word_to_document.end(),
             query.minus_words.begin(), query.minus_words.end(), it_begin);
 
-        if (it_end != it_begin) {
-            return { {}, documents_.at(document_id).status };
+        const bool has_required_words = std::all_of(query.required_words.begin(), query.required_words.end(),
+            [&word_to_document](std::string_view word) {
+                return std::binary_search(word_to_document.begin(), word_to_document.end(), word);
+            });
+
+        PhrasePositions phrase_positions(arena.GetResource());
+        if (it_end != it_begin || !has_required_words || !MatchesPhrases(query, document_id, phrase_positions)) {
+            return { std::vector<std::string_view>{}, documents_.at(document_id).status.load() };
         }
 
         it_end = std::set_intersection(policy, word_to_document.begin(), word_to_document.end(),
             query.plus_words.begin(), query.plus_words.end(), it_begin);
 
-        intersection.resize(it_end - it_begin);
-
-        return { intersection, documents_.at(document_id).status };
+        return { std::vector<std::string_view>(it_begin, it_end), documents_.at(document_id).status.load() };
     }
     
-    const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
+    using WordFrequencies = std::pmr::map<std::string_view, double>;
+
+    const WordFrequencies& GetWordFrequencies(int document_id) const;
+
+    // Reads the counters of the allocators only, so it may be polled at any time, also while the index changes
+    IndexMemoryUsage GetMemoryUsage() const;
+
+    // Walks the terms, not the postings. Must not overlap with AddDocument and RemoveDocument
+    IndexStats GetIndexStats(std::size_t top_term_count = 10) const;
     
     void RemoveDocument(int document_id);
 
@@ -136,6 +333,7 @@ public:
             || std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>)) {
             return;
         }
+        OperationTimer timer(MetricOperation::REMOVE_DOCUMENT);
 
         const auto it = documents_to_word_freqs_.find(document_id);//O(log(N))
         if (it == documents_to_word_freqs_.end()) {
@@ -148,30 +346,96 @@ public:
                 word->second.erase(document_id);
             });
 
+        const DocumentData& document_data = documents_.at(document_id);
+        total_document_length_ -= document_data.length;
+        {
+            std::unique_lock guard(metadata_mutex_);
+            all_documents_.Reset(document_id);
+            status_documents_[static_cast<int>(document_data.status.load())].Reset(document_id);
+            rating_documents_.erase({ document_data.rating.load(), document_id });
+        }
+        documents_to_word_positions_.erase(document_id);
         documents_to_word_freqs_.erase(it);
         document_ids_.erase(document_id);
         documents_.erase(document_id);
     }
     
+    // Metadata updates in place, without touching the postings of the document.
+    // Safe to call while other threads run queries; a bulk update is applied to the filter indexes at once.
+    // Throw invalid_argument for unknown ids, in which case nothing is changed.
+    void SetDocumentStatus(int document_id, DocumentStatus status);
+    void SetDocumentStatus(const std::vector<int>& document_ids, DocumentStatus status);
+    void SetDocumentRating(int document_id, int rating);
+    void SetDocumentRating(const std::vector<int>& document_ids, int rating);
+
 private:
     const int BUCKET_COUNT = 4;
 
+    using PostingList = std::pmr::map<int, double>; // document id -> term frequency
+
+    // Status and rating may be changed by SetDocumentStatus/SetDocumentRating while queries read them
     struct DocumentData {
-        int rating;
-        DocumentStatus status;
+        DocumentData(int rating, DocumentStatus status, int length)
+            : rating(rating)
+            , status(status)
+            , length(length) {
+        }
+
+        std::atomic<int> rating;
+        std::atomic<DocumentStatus> status;
+        const int length; // number of non-stop words, needed for length normalization
     };
-    std::set<std::string> source_words_;
-    const std::set<std::string, std::less<>> stop_words_;
-    std::map<std::string_view, std::map<int, double>> word_to_document_freqs_;
-    std::map<int, DocumentData> documents_;
-    std::map<int, std::map<std::string_view, double>> documents_to_word_freqs_;
-    std::set<int> document_ids_;
+    // Every structure allocates through its own resource, see GetMemoryUsage
+    CountingResource source_words_resource_;
+    CountingResource word_to_document_freqs_resource_;
+    CountingResource documents_resource_;
+    CountingResource documents_to_word_freqs_resource_;
+    CountingResource word_positions_resource_;
+    CountingResource document_ids_resource_;
+    CountingResource filter_indexes_resource_;
+
+    std::pmr::set<std::pmr::string> source_words_{ &source_words_resource_ };
+    const StopWordSet stop_words_;
+    const IndexOptions options_;
+    std::pmr::map<std::string_view, PostingList> word_to_document_freqs_{ &word_to_document_freqs_resource_ };
+    std::pmr::map<int, DocumentData> documents_{ &documents_resource_ };
+    std::pmr::map<int, WordFrequencies> documents_to_word_freqs_{ &documents_to_word_freqs_resource_ };
+    // Filled only when options_.store_positions is set
+    std::pmr::map<int, std::pmr::map<std::string_view, PositionList>> documents_to_word_positions_{ &word_positions_resource_ };
+    std::pmr::set<int> document_ids_{ &document_ids_resource_ };
+    long long total_document_length_ = 0;
+
+    // Secondary indexes for DocumentFilter, guarded by metadata_mutex_:
+    // metadata updates may run concurrently with queries
+    mutable std::shared_mutex metadata_mutex_;
+    DocumentBitmap all_documents_{ &filter_indexes_resource_ };
+    std::array<DocumentBitmap, DOCUMENT_STATUS_COUNT> status_documents_ = MakeStatusBitmaps(&filter_indexes_resource_,
+        std::make_index_sequence<DOCUMENT_STATUS_COUNT>());
+    std::pmr::set<std::pair<int, int>> rating_documents_{ &filter_indexes_resource_ }; // (rating, document id)
+
+    // A filter passing less than 1/SELECTIVE_FILTER_RATIO of the documents drives the posting scan
+    static const std::size_t SELECTIVE_FILTER_RATIO = 8;
+
+    static constexpr double RELEVANCE_KEY_SCALE = 1e6;
+
+    template <std::size_t... Statuses>
+    static std::array<DocumentBitmap, sizeof...(Statuses)> MakeStatusBitmaps(std::pmr::memory_resource* resource,
+        std::index_sequence<Statuses...>) {
+        return { (static_cast<void>(Statuses), DocumentBitmap(resource))... };
+    }
+
+    // The result is allocated from resource
+    DocumentBitmap EvaluateFilter(const DocumentFilter& filter, std::pmr::memory_resource* resource) const;
+    DocumentBitmap EvaluateFilterLocked(const DocumentFilter& filter, std::pmr::memory_resource* resource) const;
+
+    std::vector<DocumentData*> GetDocumentsForUpdate(const std::vector<int>& document_ids);
 
     bool IsStopWord(std::string_view word) const;
 
     static bool IsValidWord(std::string_view word);
 
-    std::vector<std::string> SplitIntoWordsNoStop(std::string_view text) const;
+    // positions, if given, receives the position of every returned word in the text, stop words included
+    std::vector<std::string_view> SplitIntoWordsNoStop(std::string_view text, std::vector<int>* positions = nullptr) const;
 
     static int ComputeAverageRating(const std::vector<int>& ratings);
 
@@ -179,44 +443,194 @@ private:
         std::string_view data;
         bool is_minus;
         bool is_stop;
+        bool is_required = false; // +word - only documents with the word match
+        bool is_prefix = false; // word* - expands into all the terms starting with the word
+        int max_edits = 0;      // word~N - expands into all the terms within N edits
     };
 
     QueryWord ParseQueryWord(std::string_view text) const;
 
+    // Lives in the QueryArena of its query, as a part of Query
+    struct Phrase {
+        using allocator_type = std::pmr::polymorphic_allocator<Phrase>;
+
+        explicit Phrase(const allocator_type& allocator)
+            : words(allocator)
+            , offsets(allocator) {
+        }
+
+        Phrase(Phrase&& other, const allocator_type& allocator)
+            : words(std::move(other.words), allocator)
+            , offsets(std::move(other.offsets), allocator)
+            , slop(other.slop) {
+        }
+
+        std::pmr::vector<std::string_view> words;
+        std::pmr::vector<int> offsets; // offset of each word inside the phrase, stop words included
+        int slop = 0;
+    };
+
+    // Decoded positions of the words of a phrase, reused from document to document
+    using PhrasePositions = std::pmr::vector<std::pmr::vector<int>>;
+
+    // Lives in the QueryArena of its query
     struct Query {
-        std::set<std::string_view> plus_words;
-        std::vector<std::string_view> minus_words;
+        explicit Query(std::pmr::memory_resource* resource)
+            : plus_words(resource)
+            , minus_words(resource)
+            , phrases(resource)
+            , required_words(resource) {
+        }
+
+        std::pmr::set<std::string_view> plus_words;
+        std::pmr::vector<std::string_view> minus_words;
+        std::pmr::vector<Phrase> phrases; // phrase words are also present in plus_words
+        std::pmr::vector<std::string_view> required_words; // +word and phrase words, also present in plus_words
     };
 
-    Query ParseQuery(std::string_view text) const;
+    Query ParseQuery(std::string_view text, std::pmr::memory_resource* resource) const;
 
-    // Existence required
-    double ComputeWordInverseDocumentFreq(std::string_view word) const;
+    // Adds the word or, for prefix and fuzzy words, all of its expansions found in the index
+    template <typename WordSet>
+    void AddQueryWord(const QueryWord& query_word, WordSet& words) const {
+        const auto add_term = [&words](std::string_view term, const PostingList& postings) {
+            if (!postings.empty()) {
+                words.insert(words.end(), term);
+            }
+        };
+        if (query_word.is_prefix) {
+            ForEachPrefixMatch(word_to_document_freqs_, query_word.data, add_term);
+        }
+        else if (query_word.max_edits > 0) {
+            ForEachFuzzyMatch(word_to_document_freqs_, query_word.data, query_word.max_edits, add_term,
+                words.get_allocator().resource());
+        }
+        else {
+            words.insert(words.end(), query_word.data);
+        }
+    }
+
+    // Parses the "phrase"~N starting at words[index], returns the index of its closing word
+    std::size_t ParsePhrase(const std::pmr::vector<std::string_view>& words, std::size_t index, Query& query) const;
+
+    // positions is scratch memory kept between the calls of one query.
+    // match_counts, if given, receives the number of occurrences of every phrase of the query
+    bool MatchesPhrases(const Query& query, int document_id, PhrasePositions& positions, int* match_counts = nullptr) const;
+
+    // Number of documents with the word: in the whole corpus if global_stats are given, else on this server
+    static int GetDocumentFreq(std::string_view word, const PostingList& postings, const GlobalCorpusStats* global_stats);
+
+    // Keeps only the best count documents, in result order
+    template <typename ExecutionPolicy, typename DocumentList>
+    static void SelectTopDocuments(ExecutionPolicy policy, DocumentList& documents, std::size_t count) {
+        count = std::min(count, documents.size());
+        std::partial_sort(policy, documents.begin(), documents.begin() + count, documents.end(), IsBetterDocument);
+        documents.resize(count);
+    }
+
+    template <typename ExecutionPolicy, typename DocumentPredicate, typename RankingModel>
+    std::vector<Document> FindTopDocumentsImpl(ExecutionPolicy policy, std::string_view raw_query, DocumentPredicate document_predicate,
+        const RankingModel& ranking, QueryStats* stats, QueryArena& arena, const std::pmr::vector<int>* allowed_documents = nullptr,
+        const GlobalCorpusStats* global_stats = nullptr) const {
+        OperationTimer timer(MetricOperation::FIND_TOP_DOCUMENTS);
+        const std::uint64_t start_ns = stats ? GetNowNs() : 0;
+
+        const auto query = ParseQuery(raw_query, arena.GetResource());
+        const std::uint64_t parsed_ns = stats ? GetNowNs() : 0;
+
+        auto matched_documents = FindAllDocuments(policy, query, document_predicate, ranking, stats, arena, allowed_documents, global_stats);
+        const std::uint64_t scored_ns = stats ? GetNowNs() : 0;
+
+        SelectTopDocuments(policy, matched_documents, MAX_RESULT_DOCUMENT_COUNT);
+
+        if (stats) {
+            stats->parse_ns = parsed_ns - start_ns;
+            stats->score_ns = scored_ns - parsed_ns;
+            stats->sort_ns = GetNowNs() - scored_ns;
+            stats->plus_words = query.plus_words.size();
+            stats->minus_words = query.minus_words.size();
+            stats->result_count = matched_documents.size();
+        }
+        return { matched_documents.begin(), matched_documents.end() };
+    }
+
+    // stats, if given, receives the counters of the scan.
+    // All the temporary containers and the result are allocated from arena.
+    // allowed_documents, if given, are the sorted ids of the only documents that may match.
+    // global_stats, if given, replace the local corpus statistics
+    template <typename ExecutionPolicy, typename DocumentPredicate, typename RankingModel>
+    std::pmr::vector<Document> FindAllDocuments(ExecutionPolicy policy, const Query& query, DocumentPredicate document_predicate,
+        const RankingModel& ranking, QueryStats* stats, QueryArena& arena, const std::pmr::vector<int>* allowed_documents = nullptr,
+        const GlobalCorpusStats* global_stats = nullptr) const {
+        std::pmr::memory_resource* resource = arena.GetResource();
+        const CorpusStats corpus = global_stats ? global_stats->GetCorpusStats() : GetCorpusStats();
+        std::pmr::map<int, double> document_to_relevance(resource);
+        std::pmr::vector<Document> matched_documents(resource);
+        std::size_t scored_count = 0;
+        // Postings actually visited: required words and allowed documents narrow the scan
+        std::uint64_t postings_scanned = 0;
+
+        // Only the documents having all the required (+word) words get scored
+        std::pmr::vector<int> required_documents(resource);
+        const std::pmr::vector<int>* candidates = nullptr;
+        if (!query.required_words.empty()) {
+            std::pmr::vector<const PostingList*> required_postings(resource);
+            for (std::string_view word : query.required_words) {
+                const auto it = word_to_document_freqs_.find(word);
+                if (it == word_to_document_freqs_.end()) {
+                    return matched_documents;
+                }
+                required_postings.push_back(&it->second);
+            }
+            required_documents = IntersectPostingLists(std::move(required_postings));
+            if (required_documents.empty()) {
+                return matched_documents;
+            }
+            candidates = &required_documents;
+        }
+        if (allowed_documents) {
+            if (candidates) {
+                std::pmr::vector<int> allowed_required(resource);
+                std::set_intersection(required_documents.begin(), required_documents.end(),
+                    allowed_documents->begin(), allowed_documents->end(), std::back_inserter(allowed_required));
+                required_documents = std::move(allowed_required);
+            }
+            else {
+                candidates = allowed_documents;
+            }
+            if (candidates->empty()) {
+                return matched_documents;
+            }
+        }
 
-    template <typename ExecutionPolicy, typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(ExecutionPolicy policy, const Query& query, DocumentPredicate document_predicate) const {
-        std::map<int, double> document_to_relevance;
         if constexpr (std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::parallel_policy>) {
-            ConcurrentMap<int, double> tmp(BUCKET_COUNT);
+            ConcurrentMap<int, double> tmp(BUCKET_COUNT, arena.GetSynchronizedResource());
             {
+                std::atomic<std::uint64_t> shared_postings_scanned{ 0 };
                 std::for_each(policy, query.plus_words.begin(), query.plus_words.end(),
-                    [&tmp, &document_predicate, this](std::string_view word) {
+                    [&tmp, &document_predicate, &ranking, &corpus, &shared_postings_scanned, candidates, global_stats, this](std::string_view word) {
                         auto it = word_to_document_freqs_.find(word);
-                        if (it == word_to_document_freqs_.end()) {
+                        if (it == word_to_document_freqs_.end() || it->second.empty()) {
                             return;
                         }
 
-                        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-                        for (const auto& [document_id, term_freq] : word_to_document_freqs_.at(word)) {
+                        const double inverse_document_freq = ranking.ComputeInverseDocumentFreq(corpus.document_count, GetDocumentFreq(it->first, it->second, global_stats));
+                        std::uint64_t word_postings_scanned = 0;
+                        ForEachPosting(it->second, candidates, [&](int document_id, double term_freq) {
+                            ++word_postings_scanned;
                             const auto& document_data = documents_.at(document_id);
-                            if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                                tmp[document_id].ref_to_value += term_freq * inverse_document_freq;
+                            if (document_predicate(document_id, document_data.status.load(std::memory_order_relaxed), document_data.rating.load(std::memory_order_relaxed))) {
+                                tmp[document_id].ref_to_value += ranking.ComputeTermScore(term_freq, inverse_document_freq, document_data.length, corpus);
                             }
-                        }
+                            });
+                        shared_postings_scanned.fetch_add(word_postings_scanned, std::memory_order_relaxed);
                     });
+                postings_scanned = shared_postings_scanned.load(std::memory_order_relaxed);
             }
             {
-                //LOG_DURATION("minus_words paralel");
+                if (stats) {
+                    scored_count = tmp.size();
+                }
                 std::for_each(policy, query.minus_words.begin(), query.minus_words.end(),
                     [&tmp, &word_to_document_freqs_ = word_to_document_freqs_](std::string_view word) {
                         auto it = word_to_document_freqs_.find(word);
@@ -229,27 +643,28 @@ private:
                         }
                     });
 
-                document_to_relevance = tmp.BuildOrdinaryMap();
+                document_to_relevance = tmp.BuildOrdinaryMap(resource);
             }
         }
         else if constexpr (std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>) {
             {
                 for (std::string_view word : query.plus_words) {
                     auto it = word_to_document_freqs_.find(word);
-                    if (it == word_to_document_freqs_.end()) {
+                    if (it == word_to_document_freqs_.end() || it->second.empty()) {
                         continue;
                     }
-                    const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-                    for (const auto& [document_id, term_freq] : word_to_document_freqs_.at(word)) {
+                    const double inverse_document_freq = ranking.ComputeInverseDocumentFreq(corpus.document_count, GetDocumentFreq(it->first, it->second, global_stats));
+                    ForEachPosting(it->second, candidates, [&](int document_id, double term_freq) {
+                        ++postings_scanned;
                         const auto& document_data = documents_.at(document_id);
-                        if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                            document_to_relevance[document_id] += term_freq * inverse_document_freq;
+                        if (document_predicate(document_id, document_data.status.load(std::memory_order_relaxed), document_data.rating.load(std::memory_order_relaxed))) {
+                            document_to_relevance[document_id] += ranking.ComputeTermScore(term_freq, inverse_document_freq, document_data.length, corpus);
                         }
-                    }
+                        });
                 }
             }
+            scored_count = document_to_relevance.size();
             {
-                //LOG_DURATION("minus_words seq");
                 for (std::string_view word : query.minus_words) {
                     auto it = word_to_document_freqs_.find(word);
                     if (it == word_to_document_freqs_.end()) {
@@ -263,11 +678,48 @@ private:
             }
         }
 
-        
+        const std::size_t after_minus_count = document_to_relevance.size();
+
+        if (!query.phrases.empty()) {
+            // Every phrase is scored as one more term: its frequency is the share of its occurrences in the document,
+            // its document frequency is taken from its rarest word, which bounds the one of the phrase
+            std::pmr::vector<double> phrase_inverse_document_freqs(resource);
+            for (const Phrase& phrase : query.phrases) {
+                int document_freq = corpus.document_count;
+                for (std::string_view word : phrase.words) {
+                    if (const auto it = word_to_document_freqs_.find(word); it != word_to_document_freqs_.end()) {
+                        document_freq = std::min(document_freq, GetDocumentFreq(it->first, it->second, global_stats));
+                    }
+                }
+                phrase_inverse_document_freqs.push_back(ranking.ComputeInverseDocumentFreq(corpus.document_count, std::max(document_freq, 1)));
+            }
+            std::pmr::vector<int> match_counts(query.phrases.size(), resource);
+            PhrasePositions phrase_positions(resource);
+            for (auto it = document_to_relevance.begin(); it != document_to_relevance.end();) {
+                if (MatchesPhrases(query, it->first, phrase_positions, match_counts.data())) {
+                    const int length = documents_.at(it->first).length;
+                    for (std::size_t i = 0; i < query.phrases.size(); ++i) {
+                        it->second += ranking.ComputeTermScore(match_counts[i] * 1.0 / length, phrase_inverse_document_freqs[i], length, corpus);
+                    }
+                    ++it;
+                }
+                else {
+                    it = document_to_relevance.erase(it);
+                }
+            }
+        }
+
+        if (stats) {
+            stats->postings_scanned = postings_scanned;
+            stats->documents_scored = scored_count;
+            stats->minus_word_exclusions = scored_count - after_minus_count;
+            stats->phrase_exclusions = after_minus_count - document_to_relevance.size();
+        }
 
-        std::vector<Document> matched_documents;
+        matched_documents.reserve(document_to_relevance.size());
         for (const auto& [document_id, relevance] : document_to_relevance) {
-            matched_documents.push_back({ document_id, relevance, documents_.at(document_id).rating });
+            const int rating = documents_.at(document_id).rating.load(std::memory_order_relaxed);
+            matched_documents.push_back({ document_id, ranking.ComputeRelevance(relevance, rating), rating });
         }
         return matched_documents;
     }
@@ -0,0 +1,83 @@
+#include "shard_coordinator.h"
+
+#include <algorithm>
+#include <exception>
+#include <execution>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+
+#include "search_server.h"
+#include "shard_protocol.h"
+
+using namespace std::string_literals;
+
+ShardCoordinator::ShardCoordinator(std::vector<std::unique_ptr<ShardTransport>> shards)
+    : shards_(std::move(shards)) {
+    if (shards_.empty()) {
+        throw std::invalid_argument("Coordinator needs at least one shard"s);
+    }
+}
+
+void ShardCoordinator::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
+    if (document_id < 0) {
+        throw std::invalid_argument("Document id: ["s + std::to_string(document_id) + "] is invalid"s);
+    }
+    ShardTransport& shard = *shards_[static_cast<std::size_t>(document_id) % shards_.size()];
+    ParseAddDocumentReply(shard.Call(MakeAddDocumentRequest(document_id, document, status, ratings)));
+}
+
+std::vector<Document> ShardCoordinator::FindTopDocuments(std::string_view raw_query, DocumentStatus status) {
+    GlobalCorpusStats global_stats;
+    for (const std::string& reply : Broadcast(MakeQueryStatsRequest(raw_query))) {
+        GlobalCorpusStats shard_stats = ParseQueryStatsReply(reply);
+        global_stats.document_count += shard_stats.document_count;
+        global_stats.total_document_length += shard_stats.total_document_length;
+        for (const auto& [word, document_freq] : shard_stats.document_freqs) {
+            global_stats.document_freqs[word] += document_freq;
+        }
+    }
+
+    std::vector<Document> documents;
+    for (const std::string& reply : Broadcast(MakeFindTopDocumentsRequest(raw_query, status, global_stats))) {
+        const std::vector<Document> shard_documents = ParseFindTopDocumentsReply(reply);
+        documents.insert(documents.end(), shard_documents.begin(), shard_documents.end());
+    }
+    const std::size_t count = std::min<std::size_t>(documents.size(), MAX_RESULT_DOCUMENT_COUNT);
+    std::partial_sort(documents.begin(), documents.begin() + count, documents.end(), SearchServer::IsBetterDocument);
+    documents.resize(count);
+    return documents;
+}
+
+void ShardCoordinator::Shutdown() {
+    for (const std::string& reply : Broadcast(MakeShutdownRequest())) {
+        ParseShutdownReply(reply);
+    }
+}
+
+std::size_t ShardCoordinator::GetShardCount() const {
+    return shards_.size();
+}
+
+std::vector<std::string> ShardCoordinator::Broadcast(const std::string& request) {
+    std::vector<std::string> replies(shards_.size());
+    // An exception leaving a parallel algorithm terminates the program, so errors are carried out by hand
+    std::vector<std::exception_ptr> errors(shards_.size());
+    std::vector<std::size_t> indexes(shards_.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+    std::for_each(std::execution::par, indexes.begin(), indexes.end(),
+        [&](std::size_t index) {
+            try {
+                replies[index] = shards_[index]->Call(request);
+            }
+            catch (...) {
+                errors[index] = std::current_exception();
+            }
+        });
+    for (const std::exception_ptr& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+    return replies;
+}
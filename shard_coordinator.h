@@ -0,0 +1,36 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+#include "shard_transport.h"
+
+// Scatter-gather front-end of an index split between several shards, each one a SearchServer behind a ShardTransport.
+// Documents are spread over the shards by id. A query takes two rounds: first the shards report the statistics
+// of the query terms, then every shard scores its documents with the statistics summed over all of them,
+// so the relevances are exactly those of one SearchServer holding the whole corpus. The top documents
+// of the shards are merged into the global top.
+// Ranking is TF-IDF. Calls must not overlap: every shard is called by one thread at a time.
+class ShardCoordinator {
+public:
+    explicit ShardCoordinator(std::vector<std::unique_ptr<ShardTransport>> shards);
+
+    // Errors of the shard are thrown as invalid_argument, as SearchServer does
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL);
+
+    // Stops the shard servers
+    void Shutdown();
+
+    std::size_t GetShardCount() const;
+
+private:
+    // Sends the request to all the shards at once, the replies are in the order of the shards
+    std::vector<std::string> Broadcast(const std::string& request);
+
+    std::vector<std::unique_ptr<ShardTransport>> shards_;
+};
@@ -0,0 +1,247 @@
+#include "shard_protocol.h"
+
+#include <cstring>
+#include <execution>
+#include <stdexcept>
+
+using namespace std::string_literals;
+
+namespace {
+
+enum class RequestType {
+    ADD_DOCUMENT,
+    QUERY_STATS,
+    FIND_TOP_DOCUMENTS,
+    SHUTDOWN,
+};
+
+enum class ReplyStatus {
+    OK,
+    ERROR,
+};
+
+MessageWriter StartOkReply() {
+    MessageWriter writer;
+    writer.WriteInt(static_cast<int>(ReplyStatus::OK));
+    return writer;
+}
+
+std::string MakeErrorReply(std::string_view message) {
+    MessageWriter writer;
+    writer.WriteInt(static_cast<int>(ReplyStatus::ERROR));
+    writer.WriteString(message);
+    return writer.Release();
+}
+
+// Skips the status of a successful reply
+MessageReader ReadReply(std::string_view reply) {
+    MessageReader reader(reply);
+    if (static_cast<ReplyStatus>(reader.ReadInt()) != ReplyStatus::OK) {
+        throw std::invalid_argument(std::string(reader.ReadString()));
+    }
+    return reader;
+}
+
+void WriteCorpusStats(MessageWriter& writer, const GlobalCorpusStats& stats) {
+    writer.WriteInt(stats.document_count);
+    writer.WriteInt(stats.total_document_length);
+    writer.WriteInt(static_cast<std::int64_t>(stats.document_freqs.size()));
+    for (const auto& [word, document_freq] : stats.document_freqs) {
+        writer.WriteString(word);
+        writer.WriteInt(document_freq);
+    }
+}
+
+GlobalCorpusStats ReadCorpusStats(MessageReader& reader) {
+    GlobalCorpusStats stats;
+    stats.document_count = static_cast<int>(reader.ReadInt());
+    stats.total_document_length = reader.ReadInt();
+    const std::int64_t word_count = reader.ReadInt();
+    for (std::int64_t i = 0; i < word_count; ++i) {
+        const std::string_view word = reader.ReadString();
+        stats.document_freqs.emplace(word, static_cast<int>(reader.ReadInt()));
+    }
+    return stats;
+}
+
+DocumentStatus ReadDocumentStatus(MessageReader& reader) {
+    const std::int64_t status = reader.ReadInt();
+    if (status < 0 || status >= DOCUMENT_STATUS_COUNT) {
+        throw std::invalid_argument("Document status: ["s + std::to_string(status) + "] is invalid"s);
+    }
+    return static_cast<DocumentStatus>(status);
+}
+
+std::string HandleRequest(SearchServer& search_server, MessageReader& reader) {
+    const auto type = static_cast<RequestType>(reader.ReadInt());
+    MessageWriter writer = StartOkReply();
+    switch (type) {
+    case RequestType::ADD_DOCUMENT: {
+        const int document_id = static_cast<int>(reader.ReadInt());
+        const std::string_view document = reader.ReadString();
+        const DocumentStatus status = ReadDocumentStatus(reader);
+        std::vector<int> ratings(static_cast<std::size_t>(reader.ReadInt()));
+        for (int& rating : ratings) {
+            rating = static_cast<int>(reader.ReadInt());
+        }
+        search_server.AddDocument(document_id, document, status, ratings);
+        break;
+    }
+    case RequestType::QUERY_STATS:
+        WriteCorpusStats(writer, search_server.GetQueryCorpusStats(reader.ReadString()));
+        break;
+    case RequestType::FIND_TOP_DOCUMENTS: {
+        const std::string_view raw_query = reader.ReadString();
+        const DocumentStatus status = ReadDocumentStatus(reader);
+        const GlobalCorpusStats global_stats = ReadCorpusStats(reader);
+        const auto documents = search_server.FindTopDocuments(std::execution::seq, raw_query,
+            [status](int document_id, DocumentStatus document_status, int rating) {
+                return document_status == status;
+            },
+            TfIdfRanking{}, global_stats);
+        writer.WriteInt(static_cast<std::int64_t>(documents.size()));
+        for (const Document& document : documents) {
+            writer.WriteInt(document.id);
+            writer.WriteDouble(document.relevance);
+            writer.WriteInt(document.rating);
+        }
+        break;
+    }
+    case RequestType::SHUTDOWN:
+        break;
+    default:
+        throw std::invalid_argument("Shard request type is unknown"s);
+    }
+    return writer.Release();
+}
+
+}  // namespace
+
+void MessageWriter::WriteInt(std::int64_t value) {
+    data_.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void MessageWriter::WriteDouble(double value) {
+    data_.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void MessageWriter::WriteString(std::string_view value) {
+    WriteInt(static_cast<std::int64_t>(value.size()));
+    data_.append(value);
+}
+
+std::string MessageWriter::Release() {
+    return std::move(data_);
+}
+
+MessageReader::MessageReader(std::string_view data)
+    : data_(data) {
+}
+
+std::int64_t MessageReader::ReadInt() {
+    std::int64_t value = 0;
+    std::memcpy(&value, Take(sizeof(value)).data(), sizeof(value));
+    return value;
+}
+
+double MessageReader::ReadDouble() {
+    double value = 0;
+    std::memcpy(&value, Take(sizeof(value)).data(), sizeof(value));
+    return value;
+}
+
+std::string_view MessageReader::ReadString() {
+    const std::int64_t size = ReadInt();
+    if (size < 0) {
+        throw std::invalid_argument("Shard message is malformed"s);
+    }
+    return Take(static_cast<std::size_t>(size));
+}
+
+std::string_view MessageReader::Take(std::size_t size) {
+    if (size > data_.size()) {
+        throw std::invalid_argument("Shard message is truncated"s);
+    }
+    const std::string_view result = data_.substr(0, size);
+    data_.remove_prefix(size);
+    return result;
+}
+
+std::string MakeAddDocumentRequest(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
+    MessageWriter writer;
+    writer.WriteInt(static_cast<int>(RequestType::ADD_DOCUMENT));
+    writer.WriteInt(document_id);
+    writer.WriteString(document);
+    writer.WriteInt(static_cast<int>(status));
+    writer.WriteInt(static_cast<std::int64_t>(ratings.size()));
+    for (const int rating : ratings) {
+        writer.WriteInt(rating);
+    }
+    return writer.Release();
+}
+
+std::string MakeQueryStatsRequest(std::string_view raw_query) {
+    MessageWriter writer;
+    writer.WriteInt(static_cast<int>(RequestType::QUERY_STATS));
+    writer.WriteString(raw_query);
+    return writer.Release();
+}
+
+std::string MakeFindTopDocumentsRequest(std::string_view raw_query, DocumentStatus status, const GlobalCorpusStats& global_stats) {
+    MessageWriter writer;
+    writer.WriteInt(static_cast<int>(RequestType::FIND_TOP_DOCUMENTS));
+    writer.WriteString(raw_query);
+    writer.WriteInt(static_cast<int>(status));
+    WriteCorpusStats(writer, global_stats);
+    return writer.Release();
+}
+
+std::string MakeShutdownRequest() {
+    MessageWriter writer;
+    writer.WriteInt(static_cast<int>(RequestType::SHUTDOWN));
+    return writer.Release();
+}
+
+bool IsShutdownRequest(std::string_view request) {
+    try {
+        MessageReader reader(request);
+        return static_cast<RequestType>(reader.ReadInt()) == RequestType::SHUTDOWN;
+    }
+    catch (const std::invalid_argument&) {
+        return false;
+    }
+}
+
+std::string HandleShardRequest(SearchServer& search_server, std::string_view request) {
+    try {
+        MessageReader reader(request);
+        return HandleRequest(search_server, reader);
+    }
+    catch (const std::exception& e) {
+        return MakeErrorReply(e.what());
+    }
+}
+
+void ParseAddDocumentReply(std::string_view reply) {
+    ReadReply(reply);
+}
+
+GlobalCorpusStats ParseQueryStatsReply(std::string_view reply) {
+    MessageReader reader = ReadReply(reply);
+    return ReadCorpusStats(reader);
+}
+
+std::vector<Document> ParseFindTopDocumentsReply(std::string_view reply) {
+    MessageReader reader = ReadReply(reply);
+    std::vector<Document> documents(static_cast<std::size_t>(reader.ReadInt()));
+    for (Document& document : documents) {
+        document.id = static_cast<int>(reader.ReadInt());
+        document.relevance = reader.ReadDouble();
+        document.rating = static_cast<int>(reader.ReadInt());
+    }
+    return documents;
+}
+
+void ParseShutdownReply(std::string_view reply) {
+    ReadReply(reply);
+}
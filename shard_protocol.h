@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+#include "ranking.h"
+#include "search_server.h"
+
+// Messages between a ShardCoordinator and its shards.
+// The encoding is binary in the native byte order: the coordinator and the shards run on the same host.
+// Every reply starts with a status, a failed request is answered with the error message.
+
+class MessageWriter {
+public:
+    void WriteInt(std::int64_t value);
+    void WriteDouble(double value);
+    void WriteString(std::string_view value);
+
+    std::string Release();
+
+private:
+    std::string data_;
+};
+
+// Throws invalid_argument if the message is shorter than what is read from it
+class MessageReader {
+public:
+    explicit MessageReader(std::string_view data);
+
+    std::int64_t ReadInt();
+    double ReadDouble();
+    std::string_view ReadString();
+
+private:
+    std::string_view Take(std::size_t size);
+
+    std::string_view data_;
+};
+
+std::string MakeAddDocumentRequest(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+std::string MakeQueryStatsRequest(std::string_view raw_query);
+std::string MakeFindTopDocumentsRequest(std::string_view raw_query, DocumentStatus status, const GlobalCorpusStats& global_stats);
+std::string MakeShutdownRequest();
+
+bool IsShutdownRequest(std::string_view request);
+
+// Runs the request on the shard and returns the reply
+std::string HandleShardRequest(SearchServer& search_server, std::string_view request);
+
+// Throw invalid_argument with the message of the shard if the request failed there
+void ParseAddDocumentReply(std::string_view reply);
+GlobalCorpusStats ParseQueryStatsReply(std::string_view reply);
+std::vector<Document> ParseFindTopDocumentsReply(std::string_view reply);
+void ParseShutdownReply(std::string_view reply);
@@ -0,0 +1,214 @@
+#include "shard_transport.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "shard_protocol.h"
+
+using namespace std::string_literals;
+
+namespace {
+
+// Far above any request or reply, a larger size means a corrupt or hostile frame
+const std::uint64_t MAX_MESSAGE_SIZE = 64 * 1024 * 1024;
+
+[[noreturn]] void ThrowSystemError(const std::string& what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+sockaddr_un MakeAddress(const std::string& socket_path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        throw std::invalid_argument("Socket path ["s + socket_path + "] is too long"s);
+    }
+    std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+    return address;
+}
+
+class FileDescriptor {
+public:
+    explicit FileDescriptor(int fd)
+        : fd_(fd) {
+    }
+
+    ~FileDescriptor() {
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+    }
+
+    FileDescriptor(const FileDescriptor&) = delete;
+    FileDescriptor& operator=(const FileDescriptor&) = delete;
+
+    int Get() const {
+        return fd_;
+    }
+
+    int Release() {
+        const int fd = fd_;
+        fd_ = -1;
+        return fd;
+    }
+
+private:
+    int fd_;
+};
+
+void WriteAll(int fd, const char* data, std::size_t size) {
+    while (size > 0) {
+        const ssize_t written = send(fd, data, size, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ThrowSystemError("Can't write to shard socket"s);
+        }
+        data += written;
+        size -= static_cast<std::size_t>(written);
+    }
+}
+
+// Returns false if the peer closed the connection before the first byte
+bool ReadAll(int fd, char* data, std::size_t size) {
+    const std::size_t total_size = size;
+    while (size > 0) {
+        const ssize_t read_size = recv(fd, data, size, 0);
+        if (read_size < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ThrowSystemError("Can't read from shard socket"s);
+        }
+        if (read_size == 0) {
+            if (size == total_size) {
+                return false;
+            }
+            errno = ECONNRESET;
+            ThrowSystemError("Shard socket closed in the middle of a message"s);
+        }
+        data += read_size;
+        size -= static_cast<std::size_t>(read_size);
+    }
+    return true;
+}
+
+// Messages are framed by their size
+void WriteMessage(int fd, std::string_view message) {
+    const std::uint64_t size = message.size();
+    if (size > MAX_MESSAGE_SIZE) {
+        errno = EMSGSIZE;
+        ThrowSystemError("Shard message of "s + std::to_string(size) + " bytes is too long"s);
+    }
+    WriteAll(fd, reinterpret_cast<const char*>(&size), sizeof(size));
+    WriteAll(fd, message.data(), message.size());
+}
+
+// Returns false if the peer closed the connection
+bool ReadMessage(int fd, std::string& message) {
+    std::uint64_t size = 0;
+    if (!ReadAll(fd, reinterpret_cast<char*>(&size), sizeof(size))) {
+        return false;
+    }
+    // The connection can't be trusted anymore: the rest of the frame is not read
+    if (size > MAX_MESSAGE_SIZE) {
+        errno = EMSGSIZE;
+        ThrowSystemError("Shard message of "s + std::to_string(size) + " bytes is too long"s);
+    }
+    message.resize(size);
+    if (size > 0 && !ReadAll(fd, message.data(), message.size())) {
+        errno = ECONNRESET;
+        ThrowSystemError("Shard socket closed in the middle of a message"s);
+    }
+    return true;
+}
+
+}  // namespace
+
+LocalShardTransport::LocalShardTransport(SearchServer& search_server)
+    : search_server_(search_server) {
+}
+
+std::string LocalShardTransport::Call(std::string_view request) {
+    return HandleShardRequest(search_server_, request);
+}
+
+UnixSocketShardTransport::UnixSocketShardTransport(const std::string& socket_path, std::chrono::milliseconds connect_timeout) {
+    const sockaddr_un address = MakeAddress(socket_path);
+    const auto deadline = std::chrono::steady_clock::now() + connect_timeout;
+    while (true) {
+        FileDescriptor fd(socket(AF_UNIX, SOCK_STREAM, 0));
+        if (fd.Get() < 0) {
+            ThrowSystemError("Can't create shard socket"s);
+        }
+        if (connect(fd.Get(), reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0) {
+            socket_ = fd.Release();
+            return;
+        }
+        // The shard may be still starting
+        const bool is_not_listening = errno == ENOENT || errno == ECONNREFUSED;
+        if (!is_not_listening || std::chrono::steady_clock::now() >= deadline) {
+            ThrowSystemError("Can't connect to shard ["s + socket_path + "]"s);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+UnixSocketShardTransport::~UnixSocketShardTransport() {
+    close(socket_);
+}
+
+std::string UnixSocketShardTransport::Call(std::string_view request) {
+    WriteMessage(socket_, request);
+    std::string reply;
+    if (!ReadMessage(socket_, reply)) {
+        errno = ECONNRESET;
+        ThrowSystemError("Shard closed the connection"s);
+    }
+    return reply;
+}
+
+void ServeShard(SearchServer& search_server, const std::string& socket_path) {
+    const sockaddr_un address = MakeAddress(socket_path);
+    FileDescriptor listener(socket(AF_UNIX, SOCK_STREAM, 0));
+    if (listener.Get() < 0) {
+        ThrowSystemError("Can't create shard socket"s);
+    }
+    unlink(socket_path.c_str());
+    if (bind(listener.Get(), reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0) {
+        ThrowSystemError("Can't bind shard socket ["s + socket_path + "]"s);
+    }
+    if (listen(listener.Get(), SOMAXCONN) < 0) {
+        ThrowSystemError("Can't listen on shard socket ["s + socket_path + "]"s);
+    }
+
+    bool is_shut_down = false;
+    std::string request;
+    while (!is_shut_down) {
+        FileDescriptor connection(accept(listener.Get(), nullptr, nullptr));
+        if (connection.Get() < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ThrowSystemError("Can't accept on shard socket ["s + socket_path + "]"s);
+        }
+        try {
+            while (!is_shut_down && ReadMessage(connection.Get(), request)) {
+                WriteMessage(connection.Get(), HandleShardRequest(search_server, request));
+                is_shut_down = IsShutdownRequest(request);
+            }
+        }
+        catch (const std::system_error&) {
+            // A broken connection of one coordinator doesn't stop the shard
+        }
+    }
+    unlink(socket_path.c_str());
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <string_view>
+
+#include "search_server.h"
+
+// Carries the requests of a ShardCoordinator to one shard and brings back the replies (see shard_protocol.h).
+// A transport is used by one thread at a time.
+class ShardTransport {
+public:
+    virtual ~ShardTransport() = default;
+
+    virtual std::string Call(std::string_view request) = 0;
+};
+
+// Shard in the same process
+class LocalShardTransport : public ShardTransport {
+public:
+    explicit LocalShardTransport(SearchServer& search_server);
+
+    std::string Call(std::string_view request) override;
+
+private:
+    SearchServer& search_server_;
+};
+
+// Shard in another process, served by ServeShard on a Unix domain socket.
+// Throw system_error when the connection fails.
+class UnixSocketShardTransport : public ShardTransport {
+public:
+    // Waits up to connect_timeout for the shard to start listening
+    explicit UnixSocketShardTransport(const std::string& socket_path,
+        std::chrono::milliseconds connect_timeout = std::chrono::seconds(5));
+    ~UnixSocketShardTransport() override;
+
+    UnixSocketShardTransport(const UnixSocketShardTransport&) = delete;
+    UnixSocketShardTransport& operator=(const UnixSocketShardTransport&) = delete;
+
+    std::string Call(std::string_view request) override;
+
+private:
+    int socket_ = -1;
+};
+
+// Serves the shard on a Unix domain socket until a shutdown request comes.
+// Connections are served one after another; a connection sending a broken or oversized frame is dropped.
+// Throws system_error if the socket can't be set up.
+void ServeShard(SearchServer& search_server, const std::string& socket_path);
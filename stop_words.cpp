@@ -0,0 +1,29 @@
+#include "stop_words.h"
+
+StopWordSet::StopWordSet(const std::set<std::string, std::less<>>& words)
+    : words_(words.begin(), words.end())
+{
+    // Keep the load factor at most 1/2 so probe sequences stay short
+    std::size_t capacity = 1;
+    while (capacity < words_.size() * 2) {
+        capacity *= 2;
+    }
+    slots_.resize(capacity);
+    mask_ = capacity - 1;
+
+    for (std::uint32_t index = 0; index < words_.size(); ++index) {
+        const std::string& word = words_[index];
+        const std::uint64_t hash = HashWord(word);
+        std::size_t i = hash & mask_;
+        while (slots_[i].index != EMPTY_SLOT) {
+            i = (i + 1) & mask_;
+        }
+        slots_[i] = { hash, index };
+
+        length_filter_ |= LengthBit(word.size());
+        if (!word.empty()) {
+            const auto first = static_cast<unsigned char>(word[0]);
+            first_char_filter_[first / 64] |= 1ULL << (first % 64);
+        }
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// FNV-1a, usable at compile time
+constexpr std::uint64_t HashWord(std::string_view word) {
+    std::uint64_t hash = 14695981039346656037ULL;
+    for (const char c : word) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Frozen set of stop words: an open addressing hash table built once in the constructor.
+// Most words are rejected before hashing by the length and first character filters,
+// a found slot is compared by hash first, so a miss almost never compares strings.
+class StopWordSet {
+public:
+    StopWordSet() = default;
+
+    explicit StopWordSet(const std::set<std::string, std::less<>>& words);
+
+    bool Contains(std::string_view word) const {
+        if (words_.empty() || word.empty()
+            || !(length_filter_ & LengthBit(word.size()))
+            || !(first_char_filter_[static_cast<unsigned char>(word[0]) / 64] & (1ULL << (static_cast<unsigned char>(word[0]) % 64)))) {
+            return false;
+        }
+        const std::uint64_t hash = HashWord(word);
+        for (std::size_t i = hash & mask_; slots_[i].index != EMPTY_SLOT; i = (i + 1) & mask_) {
+            if (slots_[i].hash == hash && words_[slots_[i].index] == word) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::vector<std::string>::const_iterator begin() const {
+        return words_.begin();
+    }
+
+    std::vector<std::string>::const_iterator end() const {
+        return words_.end();
+    }
+
+    std::size_t size() const {
+        return words_.size();
+    }
+
+private:
+    static constexpr std::uint32_t EMPTY_SLOT = UINT32_MAX;
+
+    struct Slot {
+        std::uint64_t hash = 0;
+        std::uint32_t index = EMPTY_SLOT;
+    };
+
+    // Words of 63 characters and longer share the last bit
+    static constexpr std::uint64_t LengthBit(std::size_t length) {
+        return 1ULL << (length < 63 ? length : 63);
+    }
+
+    std::vector<std::string> words_;
+    std::vector<Slot> slots_;
+    std::size_t mask_ = 0;
+    std::uint64_t length_filter_ = 0;
+    std::uint64_t first_char_filter_[4] = {};
+};
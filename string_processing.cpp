@@ -20,4 +20,15 @@ std::vector<std::string_view> SplitIntoWords(std::string_view text) {
     }
     result.push_back(text);
     return result;
+}
+
+std::pmr::vector<std::string_view> SplitIntoWords(std::string_view text, std::pmr::memory_resource* resource) {
+    std::pmr::vector<std::string_view> result(resource);
+    std::size_t end = 0;
+    while ((end = text.find(' ')) != std::string_view::npos) {
+        result.push_back(text.substr(0, end));
+        text.remove_prefix(end + 1);
+    }
+    result.push_back(text);
+    return result;
 }
\ No newline at end of file
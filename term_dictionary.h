@@ -0,0 +1,99 @@
+#pragma once
+
+#include <algorithm>
+#include <memory_resource>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Lookups over a term dictionary: any map sorted by std::string_view keys
+// (e.g. SearchServer::word_to_document_freqs_).
+// Sorted keys form an implicit trie: neighbouring terms share prefixes,
+// and all the terms with a given prefix are a contiguous range.
+
+// Returns the first string greater than every string starting with prefix,
+// or an empty string if there is no such string
+inline std::string PrefixSuccessor(std::string_view prefix) {
+    std::string result(prefix);
+    while (!result.empty() && static_cast<unsigned char>(result.back()) == 0xFF) {
+        result.pop_back();
+    }
+    if (!result.empty()) {
+        ++result.back();
+    }
+    return result;
+}
+
+// Calls callback(term, postings) for every term starting with prefix, in sorted order
+template <typename TermMap, typename Callback>
+void ForEachPrefixMatch(const TermMap& terms, std::string_view prefix, Callback callback) {
+    for (auto it = terms.lower_bound(prefix); it != terms.end(); ++it) {
+        if (it->first.substr(0, prefix.size()) != prefix) {
+            break;
+        }
+        callback(it->first, it->second);
+    }
+}
+
+// Calls callback(term, postings) for every term within max_distance edits
+// (insertions, deletions, substitutions) of word, in sorted order.
+// Works as a Levenshtein automaton over the sorted terms: one row of the edit distance table
+// is kept per character of the current term, rows of the prefix shared with the previous term
+// are reused, and once no extension of a prefix can match the whole subtree is skipped.
+// The table is allocated from resource.
+template <typename TermMap, typename Callback>
+void ForEachFuzzyMatch(const TermMap& terms, std::string_view word, int max_distance, Callback callback,
+    std::pmr::memory_resource* resource = std::pmr::get_default_resource()) {
+    const int width = static_cast<int>(word.size()) + 1;
+    // rows[depth * width + j] is the distance between the first depth characters of the term
+    // and the first j characters of word
+    std::pmr::vector<int> rows(width, resource);
+    std::iota(rows.begin(), rows.end(), 0);
+
+    std::string_view previous;
+    auto it = terms.begin();
+    while (it != terms.end()) {
+        const std::string_view term = it->first;
+        const std::size_t common = std::mismatch(previous.begin(), previous.end(), term.begin(), term.end()).first - previous.begin();
+        // Prefix of term whose rows are computed and still may lead to a match
+        std::size_t depth = std::min(common, rows.size() / width - 1);
+        rows.resize((depth + 1) * width);
+
+        bool dead_end = false;
+        while (depth < term.size()) {
+            const char c = term[depth];
+            rows.resize((depth + 2) * width);
+            const int* prev_row = rows.data() + depth * width;
+            int* row = rows.data() + (depth + 1) * width;
+            row[0] = prev_row[0] + 1;
+            int row_min = row[0];
+            for (int j = 1; j < width; ++j) {
+                row[j] = std::min({ prev_row[j] + 1, row[j - 1] + 1, prev_row[j - 1] + (word[j - 1] == c ? 0 : 1) });
+                row_min = std::min(row_min, row[j]);
+            }
+            ++depth;
+            if (row_min > max_distance) {
+                dead_end = true;
+                break;
+            }
+        }
+
+        if (dead_end) {
+            const std::string successor = PrefixSuccessor(term.substr(0, depth));
+            previous = term.substr(0, depth - 1);
+            rows.resize(depth * width);
+            if (successor.empty()) {
+                break;
+            }
+            it = terms.lower_bound(std::string_view(successor));
+            continue;
+        }
+
+        if (rows[depth * width + width - 1] <= max_distance) {
+            callback(term, it->second);
+        }
+        previous = term;
+        ++it;
+    }
+}
@@ -0,0 +1,519 @@
+// Behavioral checks of the search server. Exits with 1 if any check fails.
+//
+// Build it from the sources of the server, e.g.
+//   g++ -std=c++17 -O2 -I.. search_server_tests.cpp ../corpus_ingestion.cpp ../counting_resource.cpp ../document.cpp ../document_filter.cpp ../metrics.cpp ../positions.cpp
+//       ../query_arena.cpp ../request_queue.cpp ../search_server.cpp ../stop_words.cpp ../string_processing.cpp -ltbb -lpthread -o search_server_tests
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <execution>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "corpus_ingestion.h"
+#include "document_bitmap.h"
+#include "positions.h"
+#include "request_queue.h"
+#include "search_server.h"
+#include "stop_words.h"
+
+using namespace std::string_literals;
+using namespace std::string_view_literals;
+
+namespace {
+
+int failure_count = 0;
+
+void Check(bool condition, const std::string& expression, const std::string& file, int line) {
+    if (!condition) {
+        ++failure_count;
+        std::cerr << file << ":"s << line << ": check failed: "s << expression << std::endl;
+    }
+}
+
+#define CHECK(expression) Check(static_cast<bool>(expression), #expression, __FILE__, __LINE__)
+
+template <typename Exception, typename Function>
+bool Throws(Function function) {
+    try {
+        function();
+    }
+    catch (const Exception&) {
+        return true;
+    }
+    catch (...) {
+        return false;
+    }
+    return false;
+}
+
+std::vector<int> GetIds(const std::vector<Document>& documents) {
+    std::vector<int> ids;
+    for (const Document& document : documents) {
+        ids.push_back(document.id);
+    }
+    return ids;
+}
+
+void TestPhraseMatches() {
+    // Exact phrase: every place where the second word follows the first one
+    CHECK(CountPhraseMatches({ { 0, 5 }, { 1, 6, 9 } }, { 0, 1 }, 0) == 2);
+    CHECK(CountPhraseMatches({ { 0, 5 }, { 1, 6, 9 } }, { 0, 1 }, 0, 1) == 1);
+    CHECK(!HasPhraseMatch({ { 0 }, { 2 } }, { 0, 1 }, 0));
+    // A stop word inside the phrase keeps its place
+    CHECK(HasPhraseMatch({ { 3 }, { 5 } }, { 0, 2 }, 0));
+    CHECK(!HasPhraseMatch({ { 3 }, { 4 } }, { 0, 2 }, 0));
+    // Proximity: the words keep their order, the match may be up to slop positions longer
+    CHECK(HasPhraseMatch({ { 0 }, { 2 } }, { 0, 1 }, 1));
+    CHECK(!HasPhraseMatch({ { 0 }, { 3 } }, { 0, 1 }, 1));
+    CHECK(!HasPhraseMatch({ { 5 }, { 1 } }, { 0, 1 }, 10));
+    CHECK(CountPhraseMatches({ { 0, 10 }, { 2, 12 } }, { 0, 1 }, 1) == 2);
+    CHECK(HasPhraseMatch({}, {}, 0));
+}
+
+void TestPhraseQueries() {
+    SearchServer search_server("and"s, IndexOptions{ true });
+    search_server.AddDocument(1, "white cat and yellow hat"sv, DocumentStatus::ACTUAL, { 1 });
+    search_server.AddDocument(2, "yellow cat white hat"sv, DocumentStatus::ACTUAL, { 1 });
+    search_server.AddDocument(3, "cat white"sv, DocumentStatus::ACTUAL, { 1 });
+    search_server.AddDocument(4, "black dog"sv, DocumentStatus::ACTUAL, { 1 });
+
+    CHECK(GetIds(search_server.FindTopDocuments("\"white cat\""sv)) == std::vector<int>{ 1 });
+    CHECK(GetIds(search_server.FindTopDocuments("\"cat white\""sv)) == (std::vector<int>{ 3, 2 }));
+    CHECK(GetIds(search_server.FindTopDocuments("\"cat and yellow\""sv)) == std::vector<int>{ 1 });
+    CHECK(GetIds(search_server.FindTopDocuments("\"white hat\""sv)) == std::vector<int>{ 2 });
+    CHECK(GetIds(search_server.FindTopDocuments("\"white hat\"~2"sv)) == std::vector<int>{ 2 });
+    CHECK(GetIds(search_server.FindTopDocuments("\"white hat\"~3"sv)) == (std::vector<int>{ 1, 2 }));
+
+    // Phrase matches are scored on top of their words
+    const auto words = search_server.FindTopDocuments("white cat"sv);
+    const auto phrase = search_server.FindTopDocuments("\"white cat\""sv);
+    CHECK(!words.empty() && !phrase.empty());
+    for (const Document& document : words) {
+        if (document.id == 1 && !phrase.empty()) {
+            CHECK(phrase.front().relevance > document.relevance);
+        }
+    }
+
+    const auto [matched_words, status] = search_server.MatchDocument("\"white cat\""sv, 2);
+    CHECK(matched_words.empty());
+    const auto [phrase_words, phrase_status] = search_server.MatchDocument("\"white cat\""sv, 1);
+    CHECK(phrase_words.size() == 2);
+
+    CHECK(Throws<std::invalid_argument>([&] { search_server.FindTopDocuments("\"white cat"sv); }));
+    CHECK(Throws<std::invalid_argument>([&] { search_server.FindTopDocuments("\"white cat\"x"sv); }));
+    CHECK(Throws<std::invalid_argument>([&] { search_server.FindTopDocuments("\"white cat\"~"sv); }));
+    CHECK(Throws<std::invalid_argument>([&] { search_server.FindTopDocuments("\"white cat\"~99999999999"sv); }));
+    CHECK(Throws<std::invalid_argument>([&] { search_server.FindTopDocuments("\"-white cat\""sv); }));
+    CHECK(Throws<std::invalid_argument>([&] { search_server.FindTopDocuments("\"white* cat\""sv); }));
+
+    SearchServer without_positions("and"s);
+    without_positions.AddDocument(1, "white cat"sv, DocumentStatus::ACTUAL, { 1 });
+    CHECK(Throws<std::invalid_argument>([&] { without_positions.FindTopDocuments("\"white cat\""sv); }));
+}
+
+void TestPostingsScanned() {
+    SearchServer search_server("and"s);
+    for (int id = 0; id < 100; ++id) {
+        search_server.AddDocument(id, id % 10 == 0 ? "cat dog"sv : "cat"sv, DocumentStatus::ACTUAL, { 1 });
+    }
+    const auto any_document = [](int, DocumentStatus, int) { return true; };
+
+    QueryStats stats;
+    search_server.FindTopDocuments(std::execution::seq, "cat dog"sv, any_document, stats);
+    CHECK(stats.postings_scanned == 110);
+
+    // Only the postings of the documents having the required word are visited
+    QueryStats required_stats;
+    search_server.FindTopDocuments(std::execution::seq, "cat +dog"sv, any_document, required_stats);
+    CHECK(required_stats.postings_scanned == 20);
+    QueryStats parallel_stats;
+    search_server.FindTopDocuments(std::execution::par, "cat +dog"sv, any_document, parallel_stats);
+    CHECK(parallel_stats.postings_scanned == 20);
+}
+
+void TestRequestRate() {
+    const SearchServer search_server("and"s);
+    RequestQueue::Clock::time_point now{};
+    RequestQueue request_queue(search_server, std::chrono::minutes(2), [&now] { return now; });
+    const auto add_requests = [&request_queue](int count) {
+        for (int i = 0; i < count; ++i) {
+            request_queue.AddFindRequest("cat"s);
+        }
+    };
+
+    now += std::chrono::seconds(90);
+    add_requests(30);
+    CHECK(std::abs(request_queue.GetStats().queries_per_second - 30.0 / 90.0) < 1e-9);
+
+    // The window covers the previous minute and the 30 passed seconds of the current one
+    now += std::chrono::seconds(60);
+    add_requests(30);
+    CHECK(request_queue.GetStats().requests == 60);
+    CHECK(std::abs(request_queue.GetStats().queries_per_second - 60.0 / 90.0) < 1e-9);
+    CHECK(std::abs(request_queue.GetStats(std::chrono::minutes(1)).queries_per_second - 30.0 / 30.0) < 1e-9);
+}
+
+void TestPagination() {
+    SearchServer search_server("and"s);
+    for (int id = 0; id < 50; ++id) {
+        search_server.AddDocument(id, id % 3 == 0 ? "cat dog"sv : id % 3 == 1 ? "cat cat dog"sv : "cat bird"sv, DocumentStatus::ACTUAL, { id % 4 });
+    }
+    const auto any_document = [](int, DocumentStatus, int) { return true; };
+
+    const ResultPage all = search_server.FindTopDocumentsPage(std::execution::seq, "cat dog"sv, any_document, 0, 50);
+    CHECK(all.documents.size() == 50);
+    const ResultPage tail = search_server.FindTopDocumentsPage(std::execution::seq, "cat dog"sv, any_document, 5, SIZE_MAX);
+    CHECK(tail.documents.size() == 45);
+    CHECK(tail.next_cursor.empty());
+
+    // Walking the cursors visits every document once, in the order of the full result
+    std::vector<int> walked_ids;
+    std::string cursor;
+    do {
+        const ResultPage page = search_server.FindTopDocumentsAfter(std::execution::seq, "cat dog"sv, any_document, cursor, 7);
+        for (const Document& document : page.documents) {
+            walked_ids.push_back(document.id);
+        }
+        cursor = page.next_cursor;
+    } while (!cursor.empty());
+    CHECK(walked_ids == GetIds(all.documents));
+}
+
+void TestRelevanceTies() {
+    SearchServer search_server("and"s);
+    // Equal relevance on paper, the sums differ by rounding: the rating breaks the tie
+    search_server.AddDocument(1, "x"sv, DocumentStatus::ACTUAL, { 1 });
+    search_server.AddDocument(2, "x x x x x x"sv, DocumentStatus::ACTUAL, { 9 });
+    search_server.AddDocument(3, "y"sv, DocumentStatus::ACTUAL, { 5 });
+
+    CHECK(GetIds(search_server.FindTopDocuments(std::execution::seq, "x"sv)) == (std::vector<int>{ 2, 1 }));
+    CHECK(GetIds(search_server.FindTopDocuments(std::execution::par, "x"sv)) == (std::vector<int>{ 2, 1 }));
+    CHECK(SearchServer::IsBetterDocument({ 2, 1.0, 9 }, { 1, 1.0 + 1e-9, 1 }));
+    CHECK(!SearchServer::IsBetterDocument({ 1, 1.0 + 1e-9, 1 }, { 2, 1.0, 9 }));
+    CHECK(SearchServer::IsBetterDocument({ 1, 1.0 + 1e-5, 1 }, { 2, 1.0, 9 }));
+}
+
+void TestDocumentBitmap() {
+    DocumentBitmap bitmap;
+    for (const int id : { 2'000'000'000, 3, 700, 5, 511, 512 }) {
+        bitmap.Set(id);
+    }
+    CHECK(bitmap.Count() == 6);
+    CHECK(bitmap.GetIds() == (std::pmr::vector<int>{ 3, 5, 511, 512, 700, 2'000'000'000 }));
+    CHECK(bitmap.Test(2'000'000'000) && !bitmap.Test(4) && !bitmap.Test(-1));
+
+    DocumentBitmap other;
+    other.Set(5);
+    other.Set(512);
+    other.Set(1'000'000);
+    DocumentBitmap intersection = bitmap;
+    intersection &= other;
+    CHECK(intersection.GetIds() == (std::pmr::vector<int>{ 5, 512 }));
+    DocumentBitmap united = bitmap;
+    united |= other;
+    CHECK(united.Count() == 7);
+
+    bitmap.KeepRange(5, 700);
+    CHECK(bitmap.GetIds() == (std::pmr::vector<int>{ 5, 511, 512, 700 }));
+    bitmap.Reset(511);
+    bitmap.Reset(512);
+    CHECK(bitmap.GetIds() == (std::pmr::vector<int>{ 5, 700 }));
+}
+
+void TestDocumentFilter() {
+    SearchServer search_server("and"s);
+    const std::vector<int> ids = { 1, 5, 700, 70'000, 2'000'000'000 };
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        search_server.AddDocument(ids[i], "cat"sv, i % 2 == 0 ? DocumentStatus::ACTUAL : DocumentStatus::BANNED, { static_cast<int>(i) });
+    }
+    const std::vector<DocumentFilter> filters = {
+        DocumentFilter(),
+        DocumentFilter::WithStatus({ DocumentStatus::BANNED }),
+        DocumentFilter::RatingRange(1, 3),
+        DocumentFilter::IdRange(5, 70'000),
+        DocumentFilter::And({ DocumentFilter::WithStatus({ DocumentStatus::ACTUAL }), DocumentFilter::IdRange(100, INT_MAX) }),
+        DocumentFilter::Or({ DocumentFilter::IdRange(0, 1), DocumentFilter::RatingRange(4, 4) }),
+        // Inverted ranges match nothing
+        DocumentFilter::RatingRange(3, 1),
+        DocumentFilter::IdRange(70'000, 5),
+    };
+    // The indexes give the same documents as checking every document
+    for (const DocumentFilter& filter : filters) {
+        const auto expected = search_server.FindTopDocuments(std::execution::seq, "cat"sv,
+            [&filter](int document_id, DocumentStatus status, int rating) {
+                return filter.Matches(document_id, status, rating);
+            });
+        CHECK(GetIds(search_server.FindTopDocuments("cat"sv, filter)) == GetIds(expected));
+    }
+    CHECK(search_server.FindTopDocuments("cat"sv, DocumentFilter::RatingRange(3, 1)).empty());
+    CHECK(search_server.FindTopDocuments("cat"sv, DocumentFilter::IdRange(70'000, 5)).empty());
+}
+
+void TestIngestionOrder() {
+    std::string corpus;
+    for (int id = 0; id < 200; ++id) {
+        corpus += std::to_string(id) + "\tACTUAL\t1 2\tcat number"s + std::to_string(id) + "\n"s;
+    }
+    const std::size_t bad_line_offset = corpus.size();
+    corpus += "200\tUNKNOWN\t1\tcat\n"s;
+    corpus += "201\tACTUAL\t\tcat\n"s;
+    corpus += "bad line\n"s;
+
+    // Small chunks spread over several tokenizers finish out of order, the result must not depend on it
+    for (int attempt = 0; attempt < 20; ++attempt) {
+        SearchServer search_server("and"s);
+        std::string message;
+        try {
+            IngestCorpus(search_server, corpus, IngestOptions{ 64, 4, 2 });
+        }
+        catch (const std::invalid_argument& e) {
+            message = e.what();
+        }
+        CHECK(message.find("byte "s + std::to_string(bad_line_offset) + ":"s) != std::string::npos);
+        CHECK(search_server.GetDocumentCount() == 200);
+    }
+
+    SearchServer search_server("and"s);
+    const IngestStats stats = IngestCorpus(search_server, std::string_view(corpus).substr(0, bad_line_offset), IngestOptions{ 64, 4, 2 });
+    CHECK(stats.documents == 200);
+}
+
+void TestMemoryUsage() {
+    SearchServer search_server("and"s, IndexOptions{ true });
+    search_server.AddDocument(1, "white cat and yellow hat"sv, DocumentStatus::ACTUAL, { 1 });
+    search_server.AddDocument(2'000'000'000, "black dog"sv, DocumentStatus::BANNED, { 2 });
+
+    const IndexMemoryUsage usage = search_server.GetMemoryUsage();
+    CHECK(usage.word_positions > 0);
+    CHECK(usage.document_ids > 0);
+    CHECK(usage.filter_indexes > 0);
+    // The sparse filter indexes don't grow with the largest id
+    CHECK(usage.filter_indexes < 4096);
+    CHECK(usage.GetTotal() == usage.word_to_document_freqs + usage.documents_to_word_freqs + usage.source_words
+        + usage.documents + usage.word_positions + usage.document_ids + usage.filter_indexes);
+
+    search_server.RemoveDocument(1);
+    search_server.RemoveDocument(2'000'000'000);
+    const IndexMemoryUsage empty_usage = search_server.GetMemoryUsage();
+    CHECK(empty_usage.word_positions == 0);
+    CHECK(empty_usage.document_ids == 0);
+    CHECK(empty_usage.documents == 0);
+}
+
+void TestDocumentStatusRange() {
+    SearchServer search_server("and"s);
+    search_server.AddDocument(1, "cat"sv, DocumentStatus::ACTUAL, { 1 });
+    const auto bad_status = static_cast<DocumentStatus>(DOCUMENT_STATUS_COUNT);
+    CHECK(Throws<std::invalid_argument>([&] { search_server.AddDocument(2, "cat"sv, bad_status, { 1 }); }));
+    CHECK(Throws<std::invalid_argument>([&] { search_server.AddDocument(3, "cat"sv, static_cast<DocumentStatus>(-1), { 1 }); }));
+    CHECK(Throws<std::invalid_argument>([&] { search_server.SetDocumentStatus(1, bad_status); }));
+    CHECK(Throws<std::invalid_argument>([&] { search_server.SetDocumentStatus(std::vector<int>{ 1 }, bad_status); }));
+    // Nothing is changed by the rejected calls
+    CHECK(search_server.GetDocumentCount() == 1);
+    CHECK(GetIds(search_server.FindTopDocuments("cat"sv)) == std::vector<int>{ 1 });
+}
+
+void TestBulkDocumentUpdates() {
+    SearchServer search_server("and"s);
+    for (int id = 1; id <= 4; ++id) {
+        search_server.AddDocument(id, "cat"sv, DocumentStatus::ACTUAL, { id });
+    }
+    // Equal relevances, so the documents come by rating
+    search_server.SetDocumentStatus(std::vector<int>{ 1, 3 }, DocumentStatus::BANNED);
+    CHECK(GetIds(search_server.FindTopDocuments("cat"sv)) == (std::vector<int>{ 4, 2 }));
+    CHECK(GetIds(search_server.FindTopDocuments("cat"sv, DocumentFilter::WithStatus({ DocumentStatus::BANNED }))) == (std::vector<int>{ 3, 1 }));
+
+    search_server.SetDocumentRating(std::vector<int>{ 1, 4 }, 10);
+    CHECK(GetIds(search_server.FindTopDocuments("cat"sv, DocumentFilter::RatingRange(5, 10))) == (std::vector<int>{ 1, 4 }));
+    CHECK(GetIds(search_server.FindTopDocuments("cat"sv, DocumentFilter::RatingRange(1, 4))) == (std::vector<int>{ 3, 2 }));
+    CHECK(GetIds(search_server.FindTopDocuments("cat"sv)) == (std::vector<int>{ 4, 2 }));
+
+    // An unknown id fails the whole call before any document is changed
+    CHECK(Throws<std::invalid_argument>([&] { search_server.SetDocumentStatus(std::vector<int>{ 2, 5 }, DocumentStatus::BANNED); }));
+    CHECK(Throws<std::invalid_argument>([&] { search_server.SetDocumentRating(std::vector<int>{ 2, 5 }, 10); }));
+    CHECK(GetIds(search_server.FindTopDocuments("cat"sv)) == (std::vector<int>{ 4, 2 }));
+    CHECK(GetIds(search_server.FindTopDocuments("cat"sv, DocumentFilter::RatingRange(5, 10))) == (std::vector<int>{ 1, 4 }));
+    CHECK(GetIds(search_server.FindTopDocuments("cat"sv, DocumentFilter::WithStatus({ DocumentStatus::BANNED }))) == (std::vector<int>{ 1, 3 }));
+}
+
+void TestRankingModels() {
+    const auto any_document = [](int document_id, DocumentStatus status, int rating) {
+        return true;
+    };
+
+    {
+        // The default TF-IDF relevance is the share of the word times log(document count / document freq)
+        SearchServer search_server("and"s);
+        search_server.AddDocument(1, "cat dog"sv, DocumentStatus::ACTUAL, { 1 });
+        search_server.AddDocument(2, "dog bird"sv, DocumentStatus::ACTUAL, { 1 });
+        search_server.AddDocument(3, "bird fish"sv, DocumentStatus::ACTUAL, { 1 });
+        const auto documents = search_server.FindTopDocuments("cat"sv);
+        CHECK(documents.size() == 1 && std::abs(documents[0].relevance - 0.5 * std::log(3.0)) < 1e-12);
+        const auto explicit_documents = search_server.FindTopDocuments(std::execution::seq, "cat"sv, any_document, TfIdfRanking{});
+        CHECK(explicit_documents.size() == 1 && explicit_documents[0].relevance == documents[0].relevance);
+    }
+    {
+        // Same count of the word: BM25 puts the short document first, though the long one has the better rating
+        SearchServer search_server("and"s);
+        search_server.AddDocument(1, "cat dog"sv, DocumentStatus::ACTUAL, { 1 });
+        search_server.AddDocument(2, "cat dog bird fish mouse horse"sv, DocumentStatus::ACTUAL, { 9 });
+        search_server.AddDocument(3, "dog bird"sv, DocumentStatus::ACTUAL, { 1 });
+        const auto documents = search_server.FindTopDocuments(std::execution::seq, "cat"sv, any_document, Bm25Ranking{});
+        CHECK(GetIds(documents) == (std::vector<int>{ 1, 2 }));
+        CHECK(documents.size() == 2 && documents[0].relevance > documents[1].relevance);
+    }
+    {
+        // A word repeated four times scores four times as much under TF-IDF, but less than k1 + 1 times under BM25
+        SearchServer search_server("and"s);
+        search_server.AddDocument(1, "cat cat cat cat"sv, DocumentStatus::ACTUAL, { 1 });
+        search_server.AddDocument(2, "cat dog dog dog"sv, DocumentStatus::ACTUAL, { 1 });
+        search_server.AddDocument(3, "dog dog dog dog"sv, DocumentStatus::ACTUAL, { 1 });
+        const auto tf_idf = search_server.FindTopDocuments("cat"sv);
+        CHECK(tf_idf.size() == 2 && std::abs(tf_idf[0].relevance / tf_idf[1].relevance - 4.0) < 1e-9);
+
+        const Bm25Ranking bm25{ 1.2, 0.0 };
+        const auto saturated = search_server.FindTopDocuments(std::execution::seq, "cat"sv, any_document, bm25);
+        CHECK(GetIds(saturated) == (std::vector<int>{ 1, 2 }));
+        if (saturated.size() == 2) {
+            const double ratio = saturated[0].relevance / saturated[1].relevance;
+            CHECK(std::abs(ratio - (4.0 / (4.0 + bm25.k1)) / (1.0 / (1.0 + bm25.k1))) < 1e-9);
+            CHECK(ratio < bm25.k1 + 1.0);
+        }
+    }
+    {
+        // The boost scales the relevance by 1 + weight * rating and lets a better rated document overtake
+        SearchServer search_server("and"s);
+        search_server.AddDocument(1, "cat cat dog"sv, DocumentStatus::ACTUAL, { 0 });
+        search_server.AddDocument(2, "cat dog dog"sv, DocumentStatus::ACTUAL, { 10 });
+        search_server.AddDocument(3, "dog bird"sv, DocumentStatus::ACTUAL, { 0 });
+        const auto base = search_server.FindTopDocuments("cat"sv);
+        CHECK(GetIds(base) == (std::vector<int>{ 1, 2 }));
+
+        const RatingBoostedRanking<TfIdfRanking> boosted_ranking{ TfIdfRanking{}, 0.5 };
+        const auto boosted = search_server.FindTopDocuments(std::execution::seq, "cat"sv, any_document, boosted_ranking);
+        CHECK(GetIds(boosted) == (std::vector<int>{ 2, 1 }));
+        if (base.size() == 2 && boosted.size() == 2) {
+            CHECK(std::abs(boosted[0].relevance - base[1].relevance * 6.0) < 1e-12);
+            CHECK(std::abs(boosted[1].relevance - base[0].relevance) < 1e-12);
+        }
+    }
+}
+
+void TestExpandedQueryWords() {
+    SearchServer search_server("and"s);
+    const std::vector<std::string> documents = { "cat"s, "cats"s, "category"s, "cart"s, "colt"s, "dog"s, "cats dog"s, "cast dog"s };
+    for (std::size_t i = 0; i < documents.size(); ++i) {
+        search_server.AddDocument(static_cast<int>(i) + 1, documents[i], DocumentStatus::ACTUAL, { 1 });
+    }
+    // Every query below matches at most MAX_RESULT_DOCUMENT_COUNT documents, so none are cut off
+    const auto find_ids = [&search_server](std::string_view raw_query) {
+        std::vector<int> ids = GetIds(search_server.FindTopDocuments(raw_query));
+        std::sort(ids.begin(), ids.end());
+        return ids;
+    };
+    const auto match_words = [&search_server](std::string_view raw_query, int document_id) {
+        return std::get<0>(search_server.MatchDocument(raw_query, document_id));
+    };
+
+    CHECK(find_ids("cat*"sv) == (std::vector<int>{ 1, 2, 3, 7 }));
+    CHECK(match_words("cat*"sv, 3) == std::vector<std::string_view>{ "category"sv });
+    CHECK(find_ids("cat~"sv) == (std::vector<int>{ 1, 2, 4, 7, 8 }));
+    CHECK(find_ids("cat~1"sv) == find_ids("cat~"sv));
+    CHECK(match_words("cat~"sv, 5).empty());
+    CHECK(match_words("cat~2"sv, 5) == std::vector<std::string_view>{ "colt"sv });
+    CHECK(match_words("cat~2"sv, 3).empty());
+
+    // Minus words exclude every expansion
+    CHECK(find_ids("dog -cat*"sv) == (std::vector<int>{ 6, 8 }));
+    CHECK(find_ids("dog -cat~"sv) == (std::vector<int>{ 6 }));
+
+    CHECK(Throws<std::invalid_argument>([&] { search_server.FindTopDocuments("cat~3"sv); }));
+    CHECK(Throws<std::invalid_argument>([&] { search_server.FindTopDocuments("cat~x"sv); }));
+    CHECK(Throws<std::invalid_argument>([&] { search_server.FindTopDocuments("+cat*"sv); }));
+    CHECK(Throws<std::invalid_argument>([&] { search_server.FindTopDocuments("+cat~"sv); }));
+}
+
+void TestRequiredWords() {
+    SearchServer search_server("and"s);
+    const std::vector<std::string> documents = { "cat dog"s, "cat"s, "dog bird"s, "cat dog bird"s };
+    for (std::size_t i = 0; i < documents.size(); ++i) {
+        search_server.AddDocument(static_cast<int>(i) + 1, documents[i], DocumentStatus::ACTUAL, { 1 });
+    }
+    const auto find_ids = [&search_server](auto policy, std::string_view raw_query) {
+        std::vector<int> ids = GetIds(search_server.FindTopDocuments(policy, raw_query));
+        std::sort(ids.begin(), ids.end());
+        return ids;
+    };
+
+    // Every document must have all the required words, the other words only add relevance
+    CHECK(find_ids(std::execution::seq, "cat +dog"sv) == (std::vector<int>{ 1, 3, 4 }));
+    CHECK(find_ids(std::execution::par, "cat +dog"sv) == (std::vector<int>{ 1, 3, 4 }));
+    CHECK(find_ids(std::execution::seq, "cat +dog +bird"sv) == (std::vector<int>{ 3, 4 }));
+    CHECK(find_ids(std::execution::par, "cat +dog +bird"sv) == (std::vector<int>{ 3, 4 }));
+    CHECK(find_ids(std::execution::seq, "cat +dog -bird"sv) == (std::vector<int>{ 1 }));
+    CHECK(find_ids(std::execution::par, "cat +dog -bird"sv) == (std::vector<int>{ 1 }));
+
+    // A required word missing from the index matches nothing
+    CHECK(find_ids(std::execution::seq, "cat +fish"sv).empty());
+    CHECK(find_ids(std::execution::par, "cat +fish"sv).empty());
+
+    CHECK(std::get<0>(search_server.MatchDocument("cat +dog"sv, 1)) == (std::vector<std::string_view>{ "cat"sv, "dog"sv }));
+    CHECK(std::get<0>(search_server.MatchDocument("cat +dog"sv, 2)).empty());
+    CHECK(std::get<0>(search_server.MatchDocument("cat +fish"sv, 1)).empty());
+    CHECK(std::get<0>(search_server.MatchDocument(std::execution::par, "cat +fish"sv, 1)).empty());
+}
+
+void TestStopWordSet() {
+    const std::string long_word(70, 'a');
+    const StopWordSet stop_words({ "an"s, "and"s, "at"s, "in"s, "the"s, "\xE9t\xE9"s, long_word });
+    CHECK(stop_words.size() == 7);
+
+    // Stop words sharing a length and a first letter with each other are all found
+    for (const std::string_view word : { "an"sv, "and"sv, "at"sv, "in"sv, "the"sv, "\xE9t\xE9"sv, std::string_view(long_word) }) {
+        CHECK(stop_words.Contains(word));
+    }
+    // Words passing the length and first character filters are still compared in full
+    for (const std::string_view word : { "ant"sv, "are"sv, "as"sv, "it"sv, "tea"sv, "\xE9t\xE0"sv, std::string_view(long_word).substr(1), "b"sv, ""sv }) {
+        CHECK(!stop_words.Contains(word));
+    }
+    // Words of 63 characters and longer share the length filter
+    CHECK(!stop_words.Contains(std::string(63, 'a')));
+    CHECK(!stop_words.Contains(std::string(71, 'a')));
+
+    CHECK(!StopWordSet().Contains("and"sv));
+}
+
+}  // namespace
+
+int main() {
+    TestPhraseMatches();
+    TestPhraseQueries();
+    TestPostingsScanned();
+    TestRequestRate();
+    TestPagination();
+    TestRelevanceTies();
+    TestDocumentBitmap();
+    TestDocumentFilter();
+    TestIngestionOrder();
+    TestMemoryUsage();
+    TestDocumentStatusRange();
+    TestBulkDocumentUpdates();
+    TestRankingModels();
+    TestExpandedQueryWords();
+    TestRequiredWords();
+    TestStopWordSet();
+    if (failure_count > 0) {
+        std::cerr << failure_count << " checks failed"s << std::endl;
+        return 1;
+    }
+    std::cout << "OK"s << std::endl;
+    return 0;
+}